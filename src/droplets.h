@@ -0,0 +1,219 @@
+/**
+# Droplet statistics
+
+Statistics of droplets (or bubbles) are often obtained by
+post-processing [dump()](/src/output.h#dump) files, which can be very
+large. The functions below compute these statistics "in situ" and
+write them in a compact form at each timestep, typically only a few
+kilobytes.
+
+Droplets are identified using [tag()](/src/tag.h). Each droplet is
+described by its volume, interfacial area, centroid, average velocity
+and bounding box. */
+
+#include "fractions.h"
+#include "tag.h"
+
+typedef struct {
+  double volume, area;
+  coord centroid, velocity, min, max;
+} droplet;
+
+/**
+## Computing the statistics
+
+The function below tags the droplets defined by VOF tracer *f* (resp.
+the bubbles defined by $1 - f$) as connected regions for which the
+volume fraction is larger than *threshold*. It returns the number of
+droplets *n* and sets *list* to a newly-allocated array of *n*
+droplets, which must be freed by the caller. The droplets are ordered
+as their tags.
+
+The volume and centroid are computed using the volume fraction (and
+the metric), the velocity is the volume-averaged velocity *u* (or zero
+if *u* is not given) and the interfacial area is computed from the
+VOF reconstruction, as in
+[interface_area()](/src/fractions.h#interfacial-area). The bounding
+box is that of the cells of the droplet.
+
+Interfacial cells which are not tagged (because their volume fraction
+is smaller than *threshold*) are attributed to the droplet of their
+neighbouring tagged cell with the largest volume fraction (if any), so
+that their volume and area are not lost.
+
+Note that the centroid and bounding box are not correct for droplets
+which cross periodic boundaries. */
+
+trace
+int droplet_census (scalar f, droplet ** list,
+		    vector u = {{-1}},
+		    double threshold = 1e-3,
+		    bool bubbles = false)
+{
+  scalar m[];
+  foreach()
+    m[] = (bubbles ? 1. - f[] : f[]) > threshold;
+  int n = tag (m);
+
+  /**
+  The volume, area, first moments and momentum of each droplet are
+  summed in array *s*, and the bounding boxes in arrays *bmin* and
+  *bmax*. As in [remove_droplets()](/src/tag.h#removing-smallbubbles),
+  we use *foreach (serial)* since there are no OpenMP reductions for
+  arrays. */
+
+  int ns = 2 + 2*dimension;
+  double * s = qcalloc (n*ns + 1, double);
+  double * bmin = qmalloc (n*dimension + 1, double);
+  double * bmax = qmalloc (n*dimension + 1, double);
+  for (int j = 0; j < n*dimension; j++)
+    bmin[j] = HUGE, bmax[j] = - HUGE;
+  bool velocity = u.x.i >= 0;
+  foreach (serial) {
+    int j = m[] - 1;
+    if (j < 0 && f[] > 1e-6 && f[] < 1. - 1e-6) {
+      double cmax = 0.;
+      foreach_neighbor (1)
+	if (m[] > 0 && (bubbles ? 1. - f[] : f[]) > cmax)
+	  cmax = bubbles ? 1. - f[] : f[], j = m[] - 1;
+    }
+    if (j >= 0) {
+      double * sj = s + j*ns, c = bubbles ? 1. - f[] : f[];
+      sj[0] += dv()*c;
+      if (f[] > 1e-6 && f[] < 1. - 1e-6) {
+	coord n = interface_normal (point, f), p;
+	double alpha = plane_alpha (f[], n);
+	sj[1] += pow(Delta, dimension - 1)*plane_area_center (n, alpha, &p);
+      }
+      coord o = {x, y, z};
+      int k = 0;
+      foreach_dimension() {
+	sj[2 + k] += dv()*c*o.x;
+	if (velocity)
+	  sj[2 + dimension + k] += dv()*c*u.x[];
+	if (o.x - Delta/2. < bmin[j*dimension + k])
+	  bmin[j*dimension + k] = o.x - Delta/2.;
+	if (o.x + Delta/2. > bmax[j*dimension + k])
+	  bmax[j*dimension + k] = o.x + Delta/2.;
+	k++;
+      }
+    }
+  }
+
+  /**
+  When using MPI, droplets which span several processes are reduced
+  over all processes. */
+
+  mpi_all_reduce_array (s, MPI_DOUBLE, MPI_SUM, n*ns);
+  mpi_all_reduce_array (bmin, MPI_DOUBLE, MPI_MIN, n*dimension);
+  mpi_all_reduce_array (bmax, MPI_DOUBLE, MPI_MAX, n*dimension);
+
+  droplet * d = qcalloc (n + 1, droplet);
+  for (int j = 0; j < n; j++) {
+    double * sj = s + j*ns;
+    d[j].volume = sj[0], d[j].area = sj[1];
+    int k = 0;
+    foreach_dimension() {
+      if (sj[0] > 0.) {
+	d[j].centroid.x = sj[2 + k]/sj[0];
+	d[j].velocity.x = sj[2 + dimension + k]/sj[0];
+      }
+      d[j].min.x = bmin[j*dimension + k];
+      d[j].max.x = bmax[j*dimension + k];
+      k++;
+    }
+  }
+  free (s), free (bmin), free (bmax);
+  *list = d;
+  return n;
+}
+
+/**
+## Writing the statistics
+
+This function appends the statistics of the droplets at the current
+timestep to *fp*. Only the master process writes.
+
+By default, one line is written for each droplet, with comma-separated
+columns: the timestep *iter*, the time *t*, the droplet index (starting
+from one), its volume and area, the coordinates of its centroid, the
+components of its velocity and the minimum and maximum coordinates of
+its bounding box. The names of the columns are written first, if
+nothing has been written to *fp* yet (or, for pipes, on the first
+call).
+
+If *binary* is set, a record is written for the timestep, made of the
+timestep *iter* (an `int`), the time *t* (a `double`), the number of
+droplets (an `int`) and, for each droplet, the $2 + 4\times$
+*dimension* `double` values of the columns above (from the volume
+onwards). */
+
+trace
+void output_droplets (scalar f,
+		      vector u = {{-1}},
+		      FILE * fp = stdout,
+		      double threshold = 1e-3,
+		      bool bubbles = false,
+		      bool binary = false)
+{
+  droplet * d;
+  int n = droplet_census (f, &d, u, threshold, bubbles);
+  if (pid() == 0) {
+    if (binary) {
+      fwrite (&iter, sizeof (int), 1, fp);
+      fwrite (&t, sizeof (double), 1, fp);
+      fwrite (&n, sizeof (int), 1, fp);
+      for (int j = 0; j < n; j++) {
+	double a[2 + 4*dimension], * p = a;
+	*p++ = d[j].volume, *p++ = d[j].area;
+	foreach_dimension()
+	  *p++ = d[j].centroid.x;
+	foreach_dimension()
+	  *p++ = d[j].velocity.x;
+	foreach_dimension()
+	  *p++ = d[j].min.x;
+	foreach_dimension()
+	  *p++ = d[j].max.x;
+	fwrite (a, sizeof (double), 2 + 4*dimension, fp);
+      }
+    }
+    else {
+      static FILE * last = NULL;
+      long pos = ftell (fp);
+      if (pos == 0 || (pos < 0 && fp != last)) {
+	fputs ("i,t,tag,volume,area", fp);
+	for (int k = 0; k < dimension; k++)
+	  fprintf (fp, ",%c", 'x' + k);
+	for (int k = 0; k < dimension; k++)
+	  fprintf (fp, ",u.%c", 'x' + k);
+	for (int k = 0; k < dimension; k++)
+	  fprintf (fp, ",min.%c", 'x' + k);
+	for (int k = 0; k < dimension; k++)
+	  fprintf (fp, ",max.%c", 'x' + k);
+	fputc ('\n', fp);
+      }
+      last = fp;
+      for (int j = 0; j < n; j++) {
+	fprintf (fp, "%d,%g,%d,%g,%g", iter, t, j + 1, d[j].volume, d[j].area);
+	foreach_dimension()
+	  fprintf (fp, ",%g", d[j].centroid.x);
+	foreach_dimension()
+	  fprintf (fp, ",%g", d[j].velocity.x);
+	foreach_dimension()
+	  fprintf (fp, ",%g", d[j].min.x);
+	foreach_dimension()
+	  fprintf (fp, ",%g", d[j].max.x);
+	fputc ('\n', fp);
+      }
+    }
+    fflush (fp);
+  }
+  free (d);
+}
+
+/**
+## See also
+
+* [Removing small droplets](/src/tag.h#removing-smallbubbles)
+* [Counting droplets in an atomising jet](/src/examples/atomisation.c#counting-droplets)
+*/
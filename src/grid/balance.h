@@ -1,8 +1,12 @@
 // Dynamic load-balancing
 
 typedef struct {
+#if SINGLE_PRECISION
+  unsigned leaf : 1, prolongation : 1, pid : 30;
+#else
   short leaf, prolongation;
   int pid;
+#endif
 } NewPid;
 
 #define NEWPID() ((NewPid *)&val(newpid,0,0,0))
@@ -25,7 +29,16 @@ Array * linear_tree (size_t size, scalar newpid)
   bool empty = true;
   foreach_cell_all() {
     if (cell.flags & sent) {
+#if FIELD_MAJOR
+      array_append (a, &cell, sizeof(Cell));
+      real ** d = tree->L[level]->d;
+      for (int i = 0; i < (size - sizeof(Cell))/sizeof(real); i++) {
+	real v = d[i] ? d[i][cell.index] : 0.;
+	array_append (a, &v, sizeof(real));
+      }
+#else
       array_append (a, &cell, size);
+#endif
       cell.flags &= ~sent;
       empty = false;
     }
@@ -154,8 +167,15 @@ static void receive_tree (int from, scalar newpid, FILE * fp)
 		    MPI_COMM_WORLD, MPI_STATUS_IGNORE, "receive_tree (p)");
     //    const unsigned short next = 1 << (user + 1);
     foreach_tree (&a, sizeof(Cell) + datasize, NULL) {
+#if FIELD_MAJOR
+      real ** d = tree->L[level]->d, * v = (real *)(((char *)c) + sizeof(Cell));
+      for (int i = 0; i < datasize/sizeof(real); i++)
+	if (d[i])
+	  d[i][cell.index] = v[i];
+#else
       memcpy (((char *)&cell) + sizeof(Cell), ((char *)c) + sizeof(Cell),
 	      datasize);
+#endif
       assert (NEWPID()->pid > 0);
       if (fp)
 	fprintf (fp, "%g %g %g %d %d %d %d %d %d recv\n",
@@ -202,7 +222,7 @@ bool balance()
   if (npe() == 1)
     return false;
 
-  assert (sizeof(NewPid) == sizeof(double));
+  assert (sizeof(NewPid) == sizeof(real));
 
   check_flags();
 
@@ -267,7 +287,7 @@ bool balance()
       else if (pid == pid() - 1)
 	prev = true;
       NEWPID()->pid = pid + 1;
-      NEWPID()->leaf = is_leaf(cell);
+      NEWPID()->leaf = is_leaf(cell) != 0;
       NEWPID()->prolongation = is_prolongation(cell);
       if (fp)
 	fprintf (fp, "%g %g %d %d newpid\n", x, y, NEWPID()->pid - 1, cell.pid);
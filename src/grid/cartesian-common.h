@@ -179,6 +179,9 @@ scalar alloc_block_scalar (const char * name, const char * ext, int block)
 	init_block_scalar (sb, name, ext, n, block);
 	interpreter_reset_scalar (sb);
       }
+#if TREE && FIELD_MAJOR
+      alloc_scalar_data (s);
+#endif
       trash (((scalar []){s, {-1}})); // fixme: only trashes one block?
       return s;
     }
@@ -412,6 +415,10 @@ void delete (scalar * list)
   }
 
   trash (list);
+#if TREE && FIELD_MAJOR
+  for (scalar f in list)
+    free_scalar_data (f);
+#endif
   for (scalar f in list) {
     if (f.block > 0) {
       scalar * s;
@@ -95,7 +95,7 @@ macro1 is_face_y (Point p = point) {
 
 #include "neighbors.h"
 
-void reset (void * alist, double val)
+void reset (void * alist, real val)
 {
   scalar * list = (scalar *) alist;
   size_t len = sq(cartesian->n + 2);
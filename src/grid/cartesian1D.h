@@ -153,7 +153,7 @@ void free_grid (void)
 
 @if TRASH
 @ undef trash
-@ define trash(list) reset(list, undefined)
+@ define trash(list) reset(list, undefined_double)
 @endif
 
 void reset (void * alist, double val)
@@ -181,7 +181,7 @@ void init_grid (int n)
      initialised or never touched */
   double * v = (double *) p->d;
   for (int i = 0; i < len/sizeof(double); i++)
-    v[i] = undefined;
+    v[i] = undefined_double;
   grid = (Grid *) p;
   reset (all, 0.);
   // box boundaries
@@ -36,22 +36,29 @@ macro OMP_SERIAL()
   ; // necessary so that the preproc above is included
 }
    
-#elif _MPI
+#else // not OpenMP
 
 @ define OMP(x)
 macro OMP_SERIAL() {{...}}
 
+#endif // not OpenMP
+
+#if _MPI
+
+/* With both MPI and OpenMP ("hybrid" parallelism), each MPI process
+   runs several threads. tid() is then the index of the thread within
+   the process. */
+
 @ include <mpi.h>
 static int mpi_rank, mpi_npe;
-@ define tid() mpi_rank
+# if _OPENMP
+@  define tid() omp_get_thread_num()
+# else
+@  define tid() mpi_rank
+# endif
 @ define pid() mpi_rank
 @ define npe() mpi_npe
 
-#else // not MPI, not OpenMP
-
-@ define OMP(x)
-macro OMP_SERIAL() {{...}}
-
 #endif // _MPI
 
 #if _CADNA
@@ -375,7 +382,7 @@ static void trace_off()
 
 // OpenMP / MPI
   
-#if _OPENMP
+#if _OPENMP && !_MPI
 
 @define tid() omp_get_thread_num()
 @define pid() 0
@@ -481,7 +488,18 @@ void mpi_init()
   int initialized;
   MPI_Initialized (&initialized);
   if (!initialized) {
+#if _OPENMP
+    /* Communications are only done by the master thread, outside of
+       parallel regions. */
+    int provided;
+    MPI_Init_thread (NULL, NULL, MPI_THREAD_FUNNELED, &provided);
+    if (provided < MPI_THREAD_FUNNELED) {
+      fprintf (stderr, "mpi_init(): MPI does not support threads\n");
+      exit (1);
+    }
+#else
     MPI_Init (NULL, NULL);
+#endif
     MPI_Comm_set_errhandler (MPI_COMM_WORLD, MPI_ERRORS_ARE_FATAL);
     atexit (finalize);
   }
@@ -548,7 +566,16 @@ double _val_higher_dimension = 0.;
  *   http://codingcastles.blogspot.co.nz/2008/12/nans-in-c.html 
  */
 @if (_GNU_SOURCE || __APPLE__) && !_OPENMP && !_CADNA
+/* With single precision storage the signaling NaN must be a float,
+   since any conversion of a signaling NaN raises FE_INVALID. Double
+   precision contexts (e.g. Cartesian 1D grids) use *undefined_double*. */
+@ if SINGLE_PRECISION
+float undefined;
+double undefined_double;
+@ else
 double undefined;
+@   define undefined_double undefined
+@ endif
 @ if __APPLE__
 @   include <stdint.h>
 @   include "fp_osx.h"
@@ -560,13 +587,22 @@ double undefined;
 @endif
 @  define disable_fpe(flags) fedisableexcept (flags)
 static void set_fpe (void) {
+@if SINGLE_PRECISION
+  int32_t lnan = 0x7f800001;
+@else
   int64_t lnan = 0x7ff0000000000001;
-  assert (sizeof (int64_t) == sizeof (double));
-  memcpy (&undefined, &lnan, sizeof (double));
+@endif
+  assert (sizeof (lnan) == sizeof (undefined));
+  memcpy (&undefined, &lnan, sizeof (undefined));
+@if SINGLE_PRECISION
+  int64_t dlnan = 0x7ff0000000000001;
+  memcpy (&undefined_double, &dlnan, sizeof (double));
+@endif
   enable_fpe (FE_DIVBYZERO|FE_INVALID);
 }
 @else // !((_GNU_SOURCE || __APPLE__) && !_OPENMP && !_CADNA && !_GPU)
 @  define undefined ((double) DBL_MAX)
+@  define undefined_double undefined
 @  define enable_fpe(flags)
 @  define disable_fpe(flags)
 static void set_fpe (void) {}
@@ -152,6 +152,51 @@ macro2 foreach_cell_all() {
   }
 }
 
+/* foreach_cell_tasks() is a parallel (OpenMP) version of foreach_cell().
+   The cells coarser than level `split` are traversed first by a
+   single thread, then the subtrees rooted at level `split` are
+   distributed dynamically between threads. The body must only modify
+   the current cell and its descendants (e.g. their flags) and should
+   not depend on the order of traversal, which is not that of
+   foreach_cell(). */
+
+int tree_task_level = dimension == 3 ? 2 : 3;
+
+macro2 foreach_cell_tasks (int split = tree_task_level)
+{
+  {
+    Point * _roots = NULL;
+    int _nroots = 0;
+    OMP_PARALLEL() {
+      for (int _pass = 0; _pass < 2; _pass++) {
+	int _n = _pass ? _nroots : 1;
+	OMP(omp for schedule(dynamic))
+	  for (int _r = 0; _r < _n; _r++) {
+#if dimension == 1
+	    Point _root = {GHOSTS,0};
+#elif dimension == 2
+	    Point _root = {GHOSTS,GHOSTS,0};
+#else // dimension == 3
+	    Point _root = {GHOSTS,GHOSTS,GHOSTS,0};
+#endif
+	    if (_pass)
+	      _root = _roots[_r];
+	    foreach_cell_root (_root) {
+	      if (!_pass && point.level == (split)) {
+		if (_nroots % 64 == 0)
+		  _roots = (Point *) realloc (_roots, (_nroots + 64)*sizeof(Point));
+		_roots[_nroots++] = point;
+		continue;
+	      }
+	      {...}
+	    }
+	  }
+      }
+    }
+    free (_roots);
+  }
+}
+
 macro2 foreach_cell_post_root (bool condition, Point root)
 {
   {
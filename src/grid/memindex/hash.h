@@ -0,0 +1,322 @@
+/**
+# Multi-dimensional arrays using a hash table of tiles
+
+This implementation stores sparse multi-dimensional arrays as dense
+*tiles* of $2^{d\,T}$ elements (with $T$ the log2 of the tile size
+in each dimension and $d$ the dimension). The tiles are found using an
+open-addressing hash table (with linear probing) indexed by the
+coordinates of the tiles. Accessing an element thus costs a (usually
+single) probe of the hash table followed by a single dereference and
+the memory used is proportional to the number of non-empty tiles,
+rather than to the size of the arrays at each level (as for
+[virtual.h]()). This is useful for deep (3D) trees.
+
+The `Memindex` structure defines multi-dimensional arrays. The
+interface is that used by [/src/grid/tree.h](). */
+
+#if dimension == 1
+# define MEM_TILE 8
+#elif dimension == 2
+# define MEM_TILE 4
+#else // dimension == 3
+# define MEM_TILE 3
+#endif
+#define MEM_MASK ((1 << MEM_TILE) - 1)
+
+typedef struct {
+  uint64_t key; // the coordinates of the tile (plus one), zero if empty
+  int n;        // the number of allocated elements of the tile
+  char ** p;    // the elements
+} MemTile;
+
+struct _Memindex {
+  int len;
+  int n, mask;  // the number of tiles and the size of the table minus one
+  MemTile * t;  // the hash table
+};
+
+#define Memindex struct _Memindex *
+
+/**
+The key of the tile containing an element and the index of the element
+within this tile. */
+
+#if dimension == 1
+# define mem_key(i,j,k)    ((uint64_t)((i) >> MEM_TILE) + 1)
+# define mem_offset(i,j,k) ((i) & MEM_MASK)
+#elif dimension == 2
+# define mem_key(i,j,k)    ((((uint64_t)((i) >> MEM_TILE) << 32) |	\
+			     (uint64_t)((j) >> MEM_TILE)) + 1)
+# define mem_offset(i,j,k) ((((i) & MEM_MASK) << MEM_TILE) | ((j) & MEM_MASK))
+#else // dimension == 3
+# define mem_key(i,j,k)    ((((uint64_t)((i) >> MEM_TILE) << 42) |	\
+			     ((uint64_t)((j) >> MEM_TILE) << 21) |	\
+			     (uint64_t)((k) >> MEM_TILE)) + 1)
+# define mem_offset(i,j,k) ((((((i) & MEM_MASK) << MEM_TILE) |		\
+			      ((j) & MEM_MASK)) << MEM_TILE) | ((k) & MEM_MASK))
+#endif
+
+static inline unsigned mem_hash (uint64_t key)
+{
+  return (key*0x9E3779B97F4A7C15ULL) >> 32; // Fibonacci hashing
+}
+
+/**
+The `mem_tile()` function returns the elements of the tile of a given
+key, or NULL if this tile does not exist. */
+
+static inline char ** mem_tile (const Memindex m, uint64_t key)
+{
+  if (!m->t)
+    return NULL;
+  for (unsigned h = mem_hash (key) & m->mask;; h = (h + 1) & m->mask) {
+    if (m->t[h].key == key)
+      return m->t[h].p;
+    if (!m->t[h].key)
+      return NULL;
+  }
+}
+
+/**
+The `mem_data()` macros return the data stored at a specific
+(multidimensional) index. It assumes that the index is allocated. This
+can be checked with `mem_allocated()`. */
+
+#if dimension == 1
+inline static
+const bool mem_allocated (const Memindex m, const int i) {
+  if (i < 0 || i >= m->len)
+    return false;
+  char ** p = mem_tile (m, mem_key (i,0,0));
+  return p && p[mem_offset (i,0,0)];
+}
+#define mem_data(m,i) (mem_tile (m, mem_key (i,0,0))[mem_offset (i,0,0)])
+#elif dimension == 2
+inline static
+const bool mem_allocated (const Memindex m, const int i, const int j) {
+  if (i < 0 || i >= m->len || j < 0 || j >= m->len)
+    return false;
+  char ** p = mem_tile (m, mem_key (i,j,0));
+  return p && p[mem_offset (i,j,0)];
+}
+#define mem_data(m,i,j) (mem_tile (m, mem_key (i,j,0))[mem_offset (i,j,0)])
+#else // dimension == 3
+inline static
+const bool mem_allocated (const Memindex m, const int i, const int j, const int k) {
+  if (i < 0 || i >= m->len || j < 0 || j >= m->len || k < 0 || k >= m->len)
+    return false;
+  char ** p = mem_tile (m, mem_key (i,j,k));
+  return p && p[mem_offset (i,j,k)];
+}
+#define mem_data(m,i,j,k) (mem_tile (m, mem_key (i,j,k))[mem_offset (i,j,k)])
+#endif // dimension == 3
+
+/**
+The `mem_new()` function returns a new (empty) `Memindex`. */
+
+Memindex mem_new (int len)
+{
+  Memindex m = calloc (1, sizeof (struct _Memindex));
+  m->len = len;
+  return m;
+}
+
+/**
+The `mem_destroy()` function frees all the memory allocated by a given
+`Memindex`. */
+
+void mem_destroy (Memindex m, int len)
+{
+  if (m->t) {
+    for (MemTile * t = m->t; t <= m->t + m->mask; t++)
+      if (t->key)
+	free (t->p);
+    free (m->t);
+  }
+  free (m);
+}
+
+/**
+The hash table is doubled in size when it is half full. */
+
+static void mem_insert (Memindex m, MemTile * tile)
+{
+  unsigned h = mem_hash (tile->key) & m->mask;
+  while (m->t[h].key)
+    h = (h + 1) & m->mask;
+  m->t[h] = *tile;
+}
+
+static MemTile * mem_tile_new (Memindex m, uint64_t key)
+{
+  if (2*(m->n + 1) > m->mask + 1) {
+    MemTile * old = m->t;
+    int size = m->t ? m->mask + 1 : 0;
+    m->mask = size ? 2*size - 1 : 15;
+    m->t = calloc (m->mask + 1, sizeof (MemTile));
+    for (MemTile * t = old; t < old + size; t++)
+      if (t->key)
+	mem_insert (m, t);
+    free (old);
+  }
+  unsigned h = mem_hash (key) & m->mask;
+  while (m->t[h].key)
+    h = (h + 1) & m->mask;
+  m->t[h].key = key;
+  m->t[h].n = 0;
+  m->t[h].p = calloc (1 << (dimension*MEM_TILE), sizeof (char *));
+  m->n++;
+  return &m->t[h];
+}
+
+/**
+Empty tiles are removed from the table using backward-shift deletion,
+so that no "tombstones" are necessary. */
+
+static void mem_tile_remove (Memindex m, MemTile * tile)
+{
+  free (tile->p);
+  m->n--;
+  unsigned i = tile - m->t;
+  for (;;) {
+    m->t[i].key = 0;
+    unsigned j = i;
+    for (;;) {
+      j = (j + 1) & m->mask;
+      if (!m->t[j].key)
+	return;
+      unsigned k = mem_hash (m->t[j].key) & m->mask;
+      // the tile stays where it is if k is (cyclically) in ]i,j]
+      if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+	continue;
+      break;
+    }
+    m->t[i] = m->t[j];
+    i = j;
+  }
+}
+
+static MemTile * mem_find (Memindex m, uint64_t key)
+{
+  if (m->t)
+    for (unsigned h = mem_hash (key) & m->mask;; h = (h + 1) & m->mask) {
+      if (m->t[h].key == key)
+	return &m->t[h];
+      if (!m->t[h].key)
+	break;
+    }
+  return NULL;
+}
+
+/**
+The `mem_assign()` function assigns a (pointer) value to a given index. */
+
+static void mem_assign_tile (Memindex m, uint64_t key, int offset, void * b)
+{
+  MemTile * t = mem_find (m, key);
+  if (!t)
+    t = mem_tile_new (m, key);
+  if (!t->p[offset])
+    t->n++;
+  t->p[offset] = b;
+}
+
+#if dimension == 1
+void mem_assign (Memindex m, int i, int len, void * b)
+{
+  assert (b != NULL);
+  mem_assign_tile (m, mem_key (i,0,0), mem_offset (i,0,0), b);
+}
+#elif dimension == 2
+void mem_assign (Memindex m, int i, int j, int len, void * b)
+{
+  assert (b != NULL);
+  mem_assign_tile (m, mem_key (i,j,0), mem_offset (i,j,0), b);
+}
+#else // dimension == 3
+void mem_assign (Memindex m, int i, int j, int k, int len, void * b)
+{
+  assert (b != NULL);
+  mem_assign_tile (m, mem_key (i,j,k), mem_offset (i,j,k), b);
+}
+#endif // dimension == 3
+
+/**
+The `mem_free()` function frees a given index. */
+
+static void mem_free_tile (Memindex m, uint64_t key, int offset)
+{
+  MemTile * t = mem_find (m, key);
+  if (t && t->p[offset]) {
+    t->p[offset] = NULL;
+    if (--t->n == 0)
+      mem_tile_remove (m, t);
+  }
+}
+
+#if dimension == 1
+void mem_free (Memindex m, int i, int len, void * b)
+{
+  mem_free_tile (m, mem_key (i,0,0), mem_offset (i,0,0));
+}
+#elif dimension == 2
+void mem_free (Memindex m, int i, int j, int len, void * b)
+{
+  mem_free_tile (m, mem_key (i,j,0), mem_offset (i,j,0));
+}
+#else // dimension == 3
+void mem_free (Memindex m, int i, int j, int k, int len, void * b)
+{
+  mem_free_tile (m, mem_key (i,j,k), mem_offset (i,j,k));
+}
+#endif // dimension == 3
+
+/**
+The `foreach_mem()` macro traverses every `_i` allocated elements of
+array `_m` taking into account a periodicity of `_len` (and ghost
+cells). Unlike the other implementations, the elements are traversed
+tile by tile, in the (arbitrary) order of the hash table. The memory
+index must not be modified within the loop, other than by assigning
+(new) values to existing elements. */
+
+static inline int mem_first (int base, int start, int step)
+{
+  int i = max (base, start);
+  return i + (step - (i - start) % step) % step;
+}
+
+macro foreach_mem (Memindex index, int len, int _i) {
+  Memindex _m = index;
+  int _len = len;
+  Point point = {0};
+  for (MemTile * _t = _m->t; _t && _t <= _m->t + _m->mask; _t++)
+    if (_t->key) {
+      uint64_t _key = _t->key - 1;
+#if dimension == 1
+      int _bi = _key << MEM_TILE;
+#elif dimension == 2
+      int _bi = (_key >> 32) << MEM_TILE, _bj = (_key & 0xffffffff) << MEM_TILE;
+#else // dimension == 3
+      int _bi = (_key >> 42) << MEM_TILE;
+      int _bj = ((_key >> 21) & 0x1fffff) << MEM_TILE;
+      int _bk = (_key & 0x1fffff) << MEM_TILE;
+#endif
+      for (point.i = mem_first (_bi, max(Period.x*GHOSTS, 0), _i);
+	   point.i < min(_bi + (1 << MEM_TILE), min(_len - Period.x*GHOSTS, _len));
+	   point.i += _i)
+#if dimension > 1
+	for (point.j = mem_first (_bj, max(Period.y*GHOSTS, 0), _i);
+	     point.j < min(_bj + (1 << MEM_TILE),
+			   min(_len - Period.y*GHOSTS, _len));
+	     point.j += _i)
+#if dimension > 2
+	  for (point.k = mem_first (_bk, max(Period.z*GHOSTS, 0), _i);
+	       point.k < min(_bk + (1 << MEM_TILE),
+			     min(_len - Period.z*GHOSTS, _len));
+	       point.k += _i)
+#endif // dimension > 2
+#endif // dimension > 1
+	    if (_t->p[mem_offset (point.i, point.j, point.k)])
+	      {...}
+    }
+}
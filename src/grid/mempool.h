@@ -3,10 +3,33 @@
    http://www.boost.org/doc/libs/1_55_0/libs/pool/doc/html/boost_pool/pool/pooling.html
 */
 
+/* With MEMPOOL_MMAP, the (large) pools are allocated with mmap() and
+   aligned on huge pages (2 MB), which reduces TLB misses for large
+   grids. With MEMPOOL_MMAP=1, transparent huge pages are requested
+   using madvise(). With MEMPOOL_MMAP=2, explicit huge pages
+   (MAP_HUGETLB) are used if available, otherwise transparent huge
+   pages. Physical pages are placed on the NUMA node of the thread
+   which first touches them. With OpenMP, the pages of a new pool are
+   first touched (zeroed) by thread `owner`, which can be set before
+   calling mempool_alloc() (see alloc_children() in tree.h). A pool
+   fits in a single huge page, so that it is placed (and moved, see
+   mempool_move() below) as a whole. */
+
+#if MEMPOOL_MMAP
+@include <sys/mman.h>
+@include <sys/syscall.h>
+@include <unistd.h>
+# define MEMPOOL_HUGE (1 << 21)
+#endif
+
 typedef struct _Pool Pool;
 
 struct _Pool {
   Pool * next; // next pool
+#if MEMPOOL_MMAP
+  int owner;        // the thread on the node of which the pool is placed
+  int vote, count;  // see tree_place_memory() in tree.h
+#endif
 };
 
 typedef struct {
@@ -14,6 +37,10 @@ typedef struct {
   size_t size;           // block size
   size_t poolsize;       // pool size
   Pool * pool, * last;   // first and last pools
+#if MEMPOOL_MMAP
+  bool mapped;           // whether pools are allocated with mmap()
+  int owner;             // the thread touching the next pool (or -1)
+#endif
 } Mempool;
 
 typedef struct {
@@ -29,17 +56,66 @@ Mempool * mempool_new (size_t poolsize, size_t size)
   // i.e. something comparable to the size of a L2 cache
   poolsize = min(1 << 20, poolsize + sizeof(Pool));
   Mempool * m = qcalloc (1, Mempool);
+#if MEMPOOL_MMAP
+  // only the largest pools use huge pages
+  if (poolsize == 1 << 20)
+    poolsize = MEMPOOL_HUGE, m->mapped = true;
+  m->owner = -1;
+#endif
   m->poolsize = poolsize;
   m->size = size;
   return m;
 }
 
+#if MEMPOOL_MMAP
+static Pool * pool_map (size_t size)
+{
+@ if defined(MAP_HUGETLB) && MEMPOOL_MMAP == 2
+  void * h = mmap (NULL, size, PROT_READ|PROT_WRITE,
+		   MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+  if (h != MAP_FAILED)
+    return (Pool *) h;
+@ endif
+  // map twice the size to be able to align on a huge page
+  char * p1 = (char *) mmap (NULL, 2*size, PROT_READ|PROT_WRITE,
+			     MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (p1 == MAP_FAILED) {
+    perror ("pool_map(): mmap");
+    exit (1);
+  }
+  char * p = p1 + (size - ((size_t) p1) % size) % size;
+  if (p > p1)
+    munmap (p1, p - p1);
+  if (p + size < p1 + 2*size)
+    munmap (p + size, p1 + 2*size - (p + size));
+@ ifdef MADV_HUGEPAGE
+  madvise (p, size, MADV_HUGEPAGE);
+@ endif
+  return (Pool *) p;
+}
+
+static void pool_touch (Pool * p, size_t size, int owner)
+{
+#if _OPENMP
+  if (owner >= 0 && owner != omp_get_thread_num() && !omp_in_parallel())
+    OMP (omp parallel)
+      if (omp_get_thread_num() == owner)
+	memset (p, 0, size);
+#endif
+}
+#endif // MEMPOOL_MMAP
+
 void mempool_destroy (Mempool * m)
 {
   Pool * p = m->pool;
   while (p) {
     Pool * next = p->next;
-    free (p);
+#if MEMPOOL_MMAP
+    if (m->mapped)
+      munmap (p, m->poolsize);
+    else
+#endif
+      free (p);
     p = next;
   }
   free (m);
@@ -49,7 +125,23 @@ void * mempool_alloc (Mempool * m)
 {
   if (!m->first) {
     // allocate new pool
+#if MEMPOOL_MMAP
+    Pool * p;
+    if (m->mapped) {
+      p = pool_map (m->poolsize);
+      pool_touch (p, m->poolsize, m->owner);
+    }
+    else
+      p = (Pool *) malloc (m->poolsize);
+#if _OPENMP
+    p->owner = m->owner >= 0 ? m->owner : omp_get_thread_num();
+#else
+    p->owner = 0;
+#endif
+    p->count = 0;
+#else
     Pool * p = (Pool *) malloc (m->poolsize);
+#endif
     p->next = NULL;
     if (m->last)
       m->last->next = p;
@@ -75,7 +167,7 @@ void * mempool_alloc (Mempool * m)
   }
   m->first = next;
 @if TRASH
-  double * v = (double *) ret;
+  real * v = (real *) ret;
   for (int i = 0; i < m->size/sizeof(real); i++)
     v[i] = undefined;
 @endif
@@ -92,7 +184,7 @@ void * mempool_alloc0 (Mempool * m)
 void mempool_free (Mempool * m, void * p)
 {
 @if TRASH
-  double * v = (double *) p;
+  real * v = (real *) p;
   for (int i = 0; i < m->size/sizeof(real); i++)
     v[i] = undefined;
 @endif
@@ -100,3 +192,62 @@ void mempool_free (Mempool * m, void * p)
   b->next = m->first;
   m->first = (char *) p;
 }
+
+/* The number of blocks which fit in the pools of m. Since freed
+   blocks are only reused and never returned to the system, this can
+   become much larger than the number of allocated blocks after
+   coarsening, see compact_layer() in tree.h. */
+
+long mempool_capacity (Mempool * m)
+{
+  long npools = 0;
+  for (Pool * p = m->pool; p; p = p->next)
+    npools++;
+  return npools*((m->poolsize - sizeof(Pool))/m->size);
+}
+
+/* This returns true if the next call to mempool_alloc() will allocate
+   a new pool. */
+
+static inline bool mempool_full (Mempool * m)
+{
+  return !m->first;
+}
+
+/* With MEMPOOL_MMAP and OpenMP, mempool_move() moves the pages of
+   (mapped) pool `p` onto NUMA node `node`, using the move_pages system
+   call (Linux only). Since the pool is a single (huge) page, it is
+   moved as a whole. The node of the calling thread is given by
+   mempool_node(). */
+
+#if MEMPOOL_MMAP && _OPENMP
+@ifndef MPOL_MF_MOVE
+@ define MPOL_MF_MOVE (1 << 1)
+@endif
+
+int mempool_node (void)
+{
+@ifdef SYS_getcpu
+  unsigned cpu, node;
+  if (!syscall (SYS_getcpu, &cpu, &node, NULL))
+    return node;
+@endif
+  return -1;
+}
+
+long mempool_move (Mempool * m, Pool * p, int node)
+{
+  long ret = -1;
+@ifdef SYS_move_pages
+  size_t pagesize = sysconf (_SC_PAGESIZE);
+  long n = m->poolsize/pagesize;
+  void ** pages = qmalloc (n, void *);
+  int * nodes = qmalloc (n, int), * status = qmalloc (n, int);
+  for (long i = 0; i < n; i++)
+    pages[i] = ((char *) p) + i*pagesize, nodes[i] = node;
+  ret = syscall (SYS_move_pages, 0, n, pages, nodes, status, MPOL_MF_MOVE);
+  free (pages), free (nodes), free (status);
+@endif
+  return ret;
+}
+#endif // MEMPOOL_MMAP && _OPENMP
@@ -434,7 +434,7 @@ macro1 foreach_child (Point point = point, break = (_l = _m = _n = 2))
 
 #include "neighbors.h"
 
-void reset (void * alist, double val)
+void reset (void * alist, real val)
 {
   scalar * list = (scalar *) alist;
   for (scalar s in list)
@@ -589,6 +589,74 @@ macro2 foreach_boundary (int b, Reduce reductions = None)
 
 @define neighborp(k,l,o) neighbor(k,l,o)
 
+/* Caches of cell indices, with the same interface as on trees (see
+   tree.h). */
+
+typedef struct {
+  int i;
+#if dimension >= 2
+  int j;
+#endif
+#if dimension >= 3
+  int k;
+#endif
+  int level, flags;
+} Index;
+
+typedef struct {
+  Index * p;
+  int n, nm;
+} Cache;
+
+static void cache_append (Cache * c, Point p, unsigned short flags)
+{
+  if (c->n >= c->nm) {
+    c->nm += 128;
+    qrealloc (c->p, c->nm, Index);
+  }
+  c->p[c->n].i = p.i;
+#if dimension >= 2
+  c->p[c->n].j = p.j;
+#endif
+#if dimension >= 3
+  c->p[c->n].k = p.k;
+#endif
+  c->p[c->n].level = p.level;
+  c->p[c->n].flags = flags;
+  c->n++;
+}
+
+#define cache_index(c, n) ((c)->p[n])
+
+static inline Point index_point (Index p)
+{
+  Point point = {0};
+  point.i = p.i;
+#if dimension >= 2
+  point.j = p.j;
+#endif
+#if dimension >= 3
+  point.k = p.k;
+#endif
+  point.level = p.level;
+  SET_DIMENSIONS();
+  return point;
+}
+
+macro2 foreach_cache (Cache cache, Reduce reductions = None)
+{
+  OMP_PARALLEL (reductions) {
+    int ig = 0, jg = 0, kg = 0; NOT_UNUSED(ig); NOT_UNUSED(jg); NOT_UNUSED(kg);
+    Point point = {0}; NOT_UNUSED (point);
+    int _k;
+    OMP(omp for schedule(static))
+      for (_k = 0; _k < cache.n; _k++) {
+	point = index_point (cache.p[_k]);
+	{...}
+      }
+  }
+}
+
 static void box_boundary_level (const Boundary * b, scalar * scalars, int l)
 {
   disable_fpe (FE_DIVBYZERO|FE_INVALID);
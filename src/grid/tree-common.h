@@ -169,6 +169,66 @@ typedef struct {
   int nc, nf;
 } astats;
 
+/**
+The function below estimates the error made when prolongating the
+values of `point` onto its children and flags the children as too
+coarse or too fine accordingly. It only modifies (temporarily) the
+values of the children and their flags. */
+
+static void wavelet_estimate (Point point, scalar * slist, double * max,
+			      int maxlevel, int minlevel)
+{
+  static const int too_fine = 1 << (user + 1), too_coarse = 1 << (user + 2);
+  // check whether the cell or any of its children is local
+  bool local = is_local(cell);
+  if (!local)
+    foreach_child()
+      if (is_local(cell)) {
+	local = true; break;
+      }
+  if (local) {
+    int i = 0;
+    static const int just_fine = 1 << (user + 3);
+    for (scalar s in slist) {
+      double emax = max[i++], sc[(1 << dimension)*s.block];
+      double * b = sc;
+      foreach_child()
+	foreach_blockf(s)
+	  *b++ = s[];
+      s.prolongation (point, s);
+      b = sc;
+      foreach_child()
+	foreach_blockf(s) {
+	  double e = fabs(*b - s[]);
+	  if (e > emax && level < maxlevel) {
+	    cell.flags &= ~too_fine;
+	    cell.flags |= too_coarse;
+	  }
+	  else if ((e <= emax/1.5 || level > maxlevel) &&
+		   !(cell.flags & (too_coarse|just_fine))) {
+	    if (level >= minlevel)
+	      cell.flags |= too_fine;
+	  }
+	  else if (!(cell.flags & too_coarse)) {
+	    cell.flags &= ~too_fine;
+	    cell.flags |= just_fine;
+	  }
+	  s[] = *b++;
+	}
+    }
+    foreach_child() {
+      cell.flags &= ~just_fine;
+      if (!is_leaf(cell)) {
+	cell.flags &= ~too_coarse;
+	if (level >= maxlevel)
+	  cell.flags |= too_fine;
+      }
+      else if (!is_active(cell))
+	cell.flags &= ~too_coarse;
+    }
+  }
+}
+
 trace
 astats adapt_wavelet (scalar * slist,       // list of scalars
 		      double * max,         // tolerance for each scalar
@@ -206,6 +266,18 @@ astats adapt_wavelet (scalar * slist,       // list of scalars
     minlevel = 1;
   tree->refined.n = 0;
   static const int refined = 1 << user, too_fine = 1 << (user + 1);
+#if _OPENMP
+  /* With OpenMP, the errors are estimated level by level, in parallel,
+     before refining. This is safe since the estimation for a cell only
+     modifies its children. The active cache only contains local
+     cells: with MPI, the (non-local) parents of local cells are
+     estimated in the serial loop below. */
+  update_cache();
+  for (int l = 0; l < depth(); l++)
+    foreach_cache_level (tree->active[l], l)
+      if (!is_leaf(cell))
+	wavelet_estimate (point, slist, max, maxlevel, minlevel);
+#endif
   foreach_cell() {
     if (is_active(cell)) {
       static const int too_coarse = 1 << (user + 2);
@@ -223,54 +295,10 @@ astats adapt_wavelet (scalar * slist,       // list of scalars
 	  cell.flags &= ~too_coarse;
 	  continue;
 	}
-	// check whether the cell or any of its children is local
-	bool local = is_local(cell);
-	if (!local)
-	  foreach_child()
-	    if (is_local(cell)) {
-	      local = true; break;
-	    }
-	if (local) {
-	  int i = 0;
-	  static const int just_fine = 1 << (user + 3);
-	  for (scalar s in slist) {
-	    double emax = max[i++], sc[(1 << dimension)*s.block];
-	    double * b = sc;
-	    foreach_child()
-	      foreach_blockf(s)
-	        *b++ = s[];
-	    s.prolongation (point, s);
-	    b = sc;
-	    foreach_child()
-	      foreach_blockf(s) {
-	        double e = fabs(*b - s[]);
-		if (e > emax && level < maxlevel) {
-		  cell.flags &= ~too_fine;
-		  cell.flags |= too_coarse;
-		}
-		else if ((e <= emax/1.5 || level > maxlevel) &&
-			 !(cell.flags & (too_coarse|just_fine))) {
-		  if (level >= minlevel)
-		    cell.flags |= too_fine;
-		}
-		else if (!(cell.flags & too_coarse)) {
-		  cell.flags &= ~too_fine;
-		  cell.flags |= just_fine;
-		}
-		s[] = *b++;
-	      }
-	  }
-	  foreach_child() {
-	    cell.flags &= ~just_fine;
-	    if (!is_leaf(cell)) {
-	      cell.flags &= ~too_coarse;
-	      if (level >= maxlevel)
-		cell.flags |= too_fine;
-	    }
-	    else if (!is_active(cell))
-	      cell.flags &= ~too_coarse;
-	  }
-	}
+#if _OPENMP
+	if (!is_local(cell))
+#endif
+	  wavelet_estimate (point, slist, max, maxlevel, minlevel);
       }
     }
     else // inactive cell
@@ -312,6 +340,13 @@ astats adapt_wavelet (scalar * slist,       // list of scalars
   if (st.nc || st.nf)
     mpi_boundary_update (list);
 
+  if (st.nc)
+    tree_compact();
+#if MEMPOOL_MMAP && _OPENMP
+  if (st.nc || st.nf)
+    tree_place_memory();
+#endif
+
   if (list != ilist)
     free (list);
   
@@ -361,16 +396,31 @@ static void refine_level (int depth)
   } while (refined);
 }
 
-macro unrefine (bool cond)
+/**
+By default, the condition of unrefine() is evaluated by a single
+thread, in the order of foreach_cell(). If *parallel* is true (and
+with OpenMP), it is evaluated concurrently in the tasks of
+foreach_cell_tasks(): the condition must then have no side effects
+and must not depend on shared state which it modifies. */
+
+macro unrefine (bool cond, bool parallel = false)
 {
   {
     static const int too_fine = 1 << user;
-    foreach_cell() {
-      if (is_leaf(cell))
-	continue;
-      if (is_local(cell) && (cond))
-	cell.flags |= too_fine;
-    }
+    if (parallel)
+      foreach_cell_tasks() {
+	if (is_leaf(cell))
+	  continue;
+	if (is_local(cell) && (cond))
+	  cell.flags |= too_fine;
+      }
+    else
+      foreach_cell() {
+	if (is_leaf(cell))
+	  continue;
+	if (is_local(cell) && (cond))
+	  cell.flags |= too_fine;
+      }
     for (int _l = depth(); _l >= 0; _l--) {
       foreach_cell() {
 	if (is_leaf(cell))
@@ -386,6 +436,7 @@ macro unrefine (bool cond)
       mpi_boundary_coarsen (_l, too_fine);
     }
     mpi_boundary_update (all);
+    tree_compact();
   }
 }
 
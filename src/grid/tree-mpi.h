@@ -52,8 +52,9 @@ void rcv_print (Rcv * rcv, FILE * fp, const char * prefix)
 {
   for (int l = 0; l <= rcv->depth; l++)
     if (rcv->halo[l].n > 0)
-      foreach_cache_level(rcv->halo[l], l)
-	fprintf (fp, "%s%g %g %g %d %d\n", prefix, x, y, z, rcv->pid, level);
+      OMP_SERIAL()
+	foreach_cache_level(rcv->halo[l], l)
+	  fprintf (fp, "%s%g %g %g %d %d\n", prefix, x, y, z, rcv->pid, level);
 }
 
 static void rcv_free_buf (Rcv * rcv)
@@ -158,47 +159,60 @@ static Boundary * mpi_boundary = NULL;
 
 void debug_mpi (FILE * fp1);
 
+/* The MPI datatype of field values. Note also that the values of
+   the components of a block field are copied one at a time since they
+   are not contiguous with the FIELD_MAJOR layout. */
+
+#if SINGLE_PRECISION
+# define MPI_REALTYPE MPI_FLOAT
+#else
+# define MPI_REALTYPE MPI_DOUBLE
+#endif
+
 static void apply_bc (Rcv * rcv, scalar * list, scalar * listv,
 		      vector * listf, int l, MPI_Status s)
 {
-  double * b = rcv->buf;
-  foreach_cache_level(rcv->halo[l], l) {
-    for (scalar s in list) {
-      memcpy (&s[], b, sizeof(double)*s.block);
-      b += s.block;
-    }
-    for (vector v in listf)
-      foreach_dimension() {
-	memcpy (&v.x[], b, sizeof(double)*v.x.block);
-	b += v.x.block;
-	if (*b != nodata && allocated(1))
-	  memcpy (&v.x[1], b, sizeof(double)*v.x.block);
-	b += v.x.block;
-      }
-    for (scalar s in listv) {
-      for (int i = 0; i <= 1; i++)
-	for (int j = 0; j <= 1; j++)
+  real * b = rcv->buf;
+  OMP_SERIAL() // the buffer is read sequentially
+    foreach_cache_level(rcv->halo[l], l) {
+      for (scalar s in list)
+	for (scalar sb = s; sb.i < s.i + s.block; sb.i++, b++)
+	  memcpy (&sb[], b, sizeof(real));
+      for (vector v in listf)
+	foreach_dimension() {
+	  for (scalar sb = v.x; sb.i < v.x.i + v.x.block; sb.i++, b++)
+	    memcpy (&sb[], b, sizeof(real));
+	  if (*b != nodata && allocated(1))
+	    for (scalar sb = v.x; sb.i < v.x.i + v.x.block; sb.i++)
+	      memcpy (&sb[1], b + sb.i - v.x.i, sizeof(real));
+	  b += v.x.block;
+	}
+      for (scalar s in listv) {
+	for (int i = 0; i <= 1; i++)
+	  for (int j = 0; j <= 1; j++)
 #if dimension == 3
-	  for (int k = 0; k <= 1; k++) {
-	    if (*b != nodata && allocated(i,j,k))
-	      memcpy (&s[i,j,k], b, sizeof(double)*s.block);
-	    b += s.block;
-	  }
+	    for (int k = 0; k <= 1; k++) {
+	      if (*b != nodata && allocated(i,j,k))
+		for (scalar sb = s; sb.i < s.i + s.block; sb.i++)
+		  memcpy (&sb[i,j,k], b + sb.i - s.i, sizeof(real));
+	      b += s.block;
+	    }
 #else // dimension == 2
-          {
-	    if (*b != nodata && allocated(i,j))
-	      memcpy (&s[i,j], b, sizeof(double)*s.block);
-	    b += s.block;	    
-          }
+	    {
+	      if (*b != nodata && allocated(i,j))
+		for (scalar sb = s; sb.i < s.i + s.block; sb.i++)
+		  memcpy (&sb[i,j], b + sb.i - s.i, sizeof(real));
+	      b += s.block;	    
+	    }
 #endif // dimension == 2
+      }
     }
-  }
-  size_t size = b - (double *) rcv->buf;
+  size_t size = b - (real *) rcv->buf;
   free (rcv->buf);
   rcv->buf = NULL;
 
   int rlen;
-  MPI_Get_count (&s, MPI_DOUBLE, &rlen);
+  MPI_Get_count (&s, MPI_REALTYPE, &rlen);
   if (rlen != size) {
     fprintf (stderr,
 	     "rlen (%d) != size (%ld), %d receiving from %d at level %d\n"
@@ -326,19 +340,19 @@ static void rcv_pid_receive (RcvPid * m, scalar * list, scalar * listv,
     Rcv * rcv = &m->rcv[i];
     if (l <= rcv->depth && rcv->halo[l].n > 0) {
       assert (!rcv->buf);
-      rcv->buf = malloc (sizeof (double)*rcv->halo[l].n*len);
+      rcv->buf = malloc (sizeof (real)*rcv->halo[l].n*len);
 #if 0
-      fprintf (stderr, "%s receiving %d doubles from %d level %d\n",
+      fprintf (stderr, "%s receiving %d reals from %d level %d\n",
 	       m->name, rcv->halo[l].n*len, rcv->pid, l);
       fflush (stderr);
 #endif
 #if 1 /* initiate non-blocking receive */
-      MPI_Irecv (rcv->buf, rcv->halo[l].n*len, MPI_DOUBLE, rcv->pid,
+      MPI_Irecv (rcv->buf, rcv->halo[l].n*len, MPI_REALTYPE, rcv->pid,
 		 BOUNDARY_TAG(l), MPI_COMM_WORLD, &r[nr]);
       rrcv[nr++] = rcv;
 #else /* blocking receive (useful for debugging) */
       MPI_Status s;
-      mpi_recv_check (rcv->buf, rcv->halo[l].n*len, MPI_DOUBLE, rcv->pid,
+      mpi_recv_check (rcv->buf, rcv->halo[l].n*len, MPI_REALTYPE, rcv->pid,
 		      BOUNDARY_TAG(l), MPI_COMM_WORLD, &s, "rcv_pid_receive");
       apply_bc (rcv, list, listf, listv, l, s);
 #endif
@@ -386,52 +400,55 @@ static void rcv_pid_send (RcvPid * m, scalar * list, scalar * listv,
     Rcv * rcv = &m->rcv[i];
     if (l <= rcv->depth && rcv->halo[l].n > 0) {
       assert (!rcv->buf);
-      rcv->buf = malloc (sizeof (double)*rcv->halo[l].n*len);
-      double * b = rcv->buf;
-      foreach_cache_level(rcv->halo[l], l) {
-	for (scalar s in list) {
-	  memcpy (b, &s[], sizeof(double)*s.block);
-	  b += s.block;
-	}
-	for (vector v in listf)
-	  foreach_dimension() {
-	    memcpy (b, &v.x[], sizeof(double)*v.x.block);
-	    b += v.x.block;
-	    if (allocated(1))
-	      memcpy (b, &v.x[1], sizeof(double)*v.x.block);
-	    else
-	      *b = nodata;
-	    b += v.x.block;
-	  }
-	for (scalar s in listv) {
-	  for (int i = 0; i <= 1; i++)
-	    for (int j = 0; j <= 1; j++)
+      rcv->buf = malloc (sizeof (real)*rcv->halo[l].n*len);
+      real * b = rcv->buf;
+      OMP_SERIAL() // the buffer is filled sequentially
+	foreach_cache_level(rcv->halo[l], l) {
+	  for (scalar s in list)
+	    for (scalar sb = s; sb.i < s.i + s.block; sb.i++, b++)
+	      memcpy (b, &sb[], sizeof(real));
+	  for (vector v in listf)
+	    foreach_dimension() {
+	      for (scalar sb = v.x; sb.i < v.x.i + v.x.block; sb.i++, b++)
+		memcpy (b, &sb[], sizeof(real));
+	      if (allocated(1))
+		for (scalar sb = v.x; sb.i < v.x.i + v.x.block; sb.i++)
+		  memcpy (b + sb.i - v.x.i, &sb[1], sizeof(real));
+	      else
+		*b = nodata;
+	      b += v.x.block;
+	    }
+	  for (scalar s in listv) {
+	    for (int i = 0; i <= 1; i++)
+	      for (int j = 0; j <= 1; j++)
 #if dimension == 3
-	      for (int k = 0; k <= 1; k++) {
-		if (allocated(i,j,k))
-		  memcpy (b, &s[i,j,k], sizeof(double)*s.block);
-		else
-		  *b = nodata;
-		b += s.block;
-	      }
+		for (int k = 0; k <= 1; k++) {
+		  if (allocated(i,j,k))
+		    for (scalar sb = s; sb.i < s.i + s.block; sb.i++)
+		      memcpy (b + sb.i - s.i, &sb[i,j,k], sizeof(real));
+		  else
+		    *b = nodata;
+		  b += s.block;
+		}
 #else // dimension == 2
-	      {
-		if (allocated(i,j))
-		  memcpy (b, &s[i,j], sizeof(double)*s.block);
-		else
-		  *b = nodata;
-		b += s.block;
-	      }
+		{
+		  if (allocated(i,j))
+		    for (scalar sb = s; sb.i < s.i + s.block; sb.i++)
+		      memcpy (b + sb.i - s.i, &sb[i,j], sizeof(real));
+		  else
+		    *b = nodata;
+		  b += s.block;
+		}
 #endif // dimension == 2
+	  }
 	}
-      }
 #if 0
-      fprintf (stderr, "%s sending %d doubles to %d level %d\n",
+      fprintf (stderr, "%s sending %d reals to %d level %d\n",
 	       m->name, rcv->halo[l].n*len, rcv->pid, l);
       fflush (stderr);
 #endif
-      MPI_Isend (rcv->buf, (b - (double *) rcv->buf),
-		 MPI_DOUBLE, rcv->pid, BOUNDARY_TAG(l), MPI_COMM_WORLD,
+      MPI_Isend (rcv->buf, (b - (real *) rcv->buf),
+		 MPI_REALTYPE, rcv->pid, BOUNDARY_TAG(l), MPI_COMM_WORLD,
 		 &rcv->r);
     }
   }
@@ -565,9 +582,10 @@ void debug_mpi (FILE * fp1)
   // local halo
   fp = fopen_prefix (fp1, "halo", prefix);
   for (int l = 0; l < depth(); l++)
-    foreach_halo (prolongation, l)
-      foreach_child()
-        fprintf (fp, "%s%g %g %g %d\n", prefix, x, y, z, level);
+    OMP_SERIAL()
+      foreach_halo (prolongation, l)
+	foreach_child()
+	  fprintf (fp, "%s%g %g %g %d\n", prefix, x, y, z, level);
   if (!fp1)
     fclose (fp);
 
@@ -578,19 +596,19 @@ void debug_mpi (FILE * fp1)
   }
   
   fp = fopen_prefix (fp1, "faces", prefix);
-  foreach_face()
+  foreach_face (serial)
     fprintf (fp, "%s%g %g %g %d\n", prefix, x, y, z, level);
   if (!fp1)
     fclose (fp);
 
   fp = fopen_prefix (fp1, "vertices", prefix);
-  foreach_vertex()
+  foreach_vertex (serial)
     fprintf (fp, "%s%g %g %g %d\n", prefix, x, y, z, level);
   if (!fp1)
     fclose (fp);
 
   fp = fopen_prefix (fp1, "neighbors", prefix);
-  foreach() {
+  foreach (serial) {
     int n = 0;
     foreach_neighbor(1)
       if (is_refined(cell))
@@ -676,8 +694,9 @@ void debug_mpi (FILE * fp1)
     fclose (fp);
 
   fp = fopen_prefix (fp1, "refined", prefix);
-  foreach_cache (tree->refined)
-    fprintf (fp, "%s%g %g %g %d\n", prefix, x, y, z, level);
+  OMP_SERIAL()
+    foreach_cache (tree->refined)
+      fprintf (fp, "%s%g %g %g %d\n", prefix, x, y, z, level);
   if (!fp1)
     fclose (fp);
 }
@@ -1030,8 +1049,8 @@ void mpi_boundary_refine (scalar * list)
     MPI_Isend (&tree->refined.n, 1, MPI_INT, *dest,
 	       REFINE_TAG(), MPI_COMM_WORLD, &r[nr++]);
     if (len > 0)
-      MPI_Isend (tree->refined.p, sizeof(Index)/sizeof(int)*len,
-		 MPI_INT, *dest, REFINE_TAG(), MPI_COMM_WORLD, &r[nr++]);
+      MPI_Isend (tree->refined.p, sizeof(CacheIndex)*len,
+		 MPI_BYTE, *dest, REFINE_TAG(), MPI_COMM_WORLD, &r[nr++]);
   }
 
   /* Receive refinement cache from each neighboring process. 
@@ -1044,25 +1063,26 @@ void mpi_boundary_refine (scalar * list)
 		    MPI_COMM_WORLD, MPI_STATUS_IGNORE,
 		    "mpi_boundary_refine (len)");
     if (len > 0) {
-      Index p[len];
-      mpi_recv_check (p, sizeof(Index)/sizeof(int)*len,
-		      MPI_INT, *source, REFINE_TAG(),
+      CacheIndex p[len];
+      mpi_recv_check (p, sizeof(CacheIndex)*len,
+		      MPI_BYTE, *source, REFINE_TAG(),
 		      MPI_COMM_WORLD, MPI_STATUS_IGNORE,
 		      "mpi_boundary_refine (p)");
       Cache refined = {p, len, len};
-      foreach_cache (refined)
-	if (level <= depth() && allocated(0)) {
-	  if (is_leaf(cell)) {
-	    bool neighbors = false;
-	    foreach_neighbor()
-	      if (allocated(0) && (is_active(cell) || is_local(aparent(0)))) {
-		neighbors = true; break;
-	      }
-	    // refine the cell only if it has local neighbors
-	    if (neighbors)
-	      refine_cell (point, list, 0, &rerefined);
+      OMP_SERIAL() // refine_cell() is not thread-safe
+	foreach_cache (refined)
+	  if (level <= depth() && allocated(0)) {
+	    if (is_leaf(cell)) {
+	      bool neighbors = false;
+	      foreach_neighbor()
+		if (allocated(0) && (is_active(cell) || is_local(aparent(0)))) {
+		  neighbors = true; break;
+		}
+	      // refine the cell only if it has local neighbors
+	      if (neighbors)
+		refine_cell (point, list, 0, &rerefined);
+	    }
 	  }
-	}
     }
   }
 
@@ -1120,8 +1140,15 @@ static void check_depth()
 #endif
 }
 
+/* Remote (and NewPid in [balance.h]()) must fit in a single field
+   value. */
+
 typedef struct {
+#if SINGLE_PRECISION
+  unsigned refined : 1, leaf : 1;
+#else
   int refined, leaf;
+#endif
 } Remote;
 
 #define REMOTE() ((Remote *)&val(remote,0))
@@ -1134,14 +1161,14 @@ void mpi_boundary_coarsen (int l, int too_fine)
   
   check_depth();
 
-  assert (sizeof(Remote) == sizeof(double));
+  assert (sizeof(Remote) == sizeof(real));
   
   scalar remote[];
   foreach_cell() {
     if (level == l) {
       if (is_local(cell)) {
 	REMOTE()->refined = is_refined(cell);
-	REMOTE()->leaf = is_leaf(cell);
+	REMOTE()->leaf = is_leaf(cell) != 0;
       }
       else {
 	REMOTE()->refined = true;
@@ -1,4 +1,8 @@
+#if SINGLE_PRECISION
+typedef float real;
+#else
 typedef double real;
+#endif
 
 #include "mempool.h"
 
@@ -23,8 +27,17 @@ struct _Point {
 #endif
 };
 
-//#include "memindex/range.h"
-#include "memindex/virtual.h"
+/* The memory index of each level uses virtual memory by default. The
+   range-based (MEMINDEX_RANGE) or hashed (MEMINDEX_HASH)
+   implementations can also be used, see test/memindex.c. */
+
+#if MEMINDEX_HASH
+# include "memindex/hash.h"
+#elif MEMINDEX_RANGE
+# include "memindex/range.h"
+#else
+# include "memindex/virtual.h"
+#endif
 
 #if LAYERS
 # include "grid/layers.h"
@@ -51,6 +64,9 @@ typedef struct {
   // number of refined neighbors in a 3^dimension neighborhood
   unsigned short neighbors;
   int pid; // process id
+#if FIELD_MAJOR
+  long index; // index of the cell in the field arrays of its level
+#endif
 } Cell;
 
 enum {
@@ -104,18 +120,70 @@ typedef struct {
   int level, flags;
 } Index;
 
+/* With MORTON_CACHE, each cache entry is packed into a single 64-bit
+   key holding (from most to least significant bits) the interleaved
+   coordinates of the cell (scaled to the finest level), its level (5
+   bits) and its face flags (3 bits). Keys are thus sorted in Z-order,
+   i.e. in the order of foreach_cell() and z_indexing(). */
+
+#if MORTON_CACHE
+typedef uint64_t CacheIndex;
+// one bit is used for indices on the right/top/front sides of the domain
+# if dimension == 1
+#  define MORTON_BITS 56
+#  define MORTON_MAXLEVEL 31
+# elif dimension == 2
+#  define MORTON_BITS 28
+#  define MORTON_MAXLEVEL 27
+# else // dimension == 3
+#  define MORTON_BITS 18
+#  define MORTON_MAXLEVEL 17
+# endif
+#else
+typedef Index CacheIndex;
+#endif
+
 typedef struct {
-  Index * p;
+  CacheIndex * p;
   int n, nm;
 } Cache;
 
 // Layer
 
+/* With the default (cell-major) layout, the values of all fields are
+   stored contiguously after the Cell header of each cell. With
+   FIELD_MAJOR, each level stores one contiguous array per field and
+   the Cell header only holds the index of the cell in these arrays,
+   so that loops touching a few fields only load these fields.
+
+   Note that the default layout has no separate storage for temporary
+   fields: allocating a temporary field (e.g. `scalar flux[]`) which
+   does not fit in the slots of deleted fields grows every cell of
+   the tree, and this memory is not released when the field is
+   deleted. Only FIELD_MAJOR frees the memory of deleted fields (see
+   the Tips page). */
+
+#if FIELD_MAJOR
+# if _GPU
+#  error "FIELD_MAJOR is not compatible with GPUs"
+# endif
+# define cell_size() sizeof(Cell)
+#else
+# define cell_size() (sizeof(Cell) + datasize)
+#endif
+
 typedef struct {
   Memindex m; // the structure indexing the data
   Mempool * pool; // the memory pool actually holding the data
   long nc;     // the number of allocated elements
   int len;    // the (1D) size of the array
+#if FIELD_MAJOR
+  real ** d;    // the field arrays
+  long nm;      // the (allocated) size of each field array
+  long nb;      // the number of block indices in use (or freed)
+  Array * free; // the freed block indices
+  bool placed;  // false if the arrays have grown since their placement
+#endif
 } Layer;
 
 static size_t _size (size_t depth)
@@ -142,13 +210,19 @@ static Layer * new_layer (int depth)
   if (depth == 0)
     l->pool = NULL; // the root layer does not use a pool
   else {
-    size_t size = sizeof(Cell) + datasize;
+    size_t size = cell_size();
     // the block size is 2^dimension*size because we allocate
     // 2^dimension children at a time
     l->pool = mempool_new (poolsize (depth, size), (1 << dimension)*size);
   }
   l->m = mem_new (l->len);
   l->nc = 0;
+#if FIELD_MAJOR
+  l->d = qcalloc (datasize/sizeof(real) + 1, real *);
+  l->nm = l->nb = 0;
+  l->free = array_new();
+  l->placed = true;
+#endif
   return l;
 }
 
@@ -157,9 +231,53 @@ static void destroy_layer (Layer * l)
   if (l->pool)
     mempool_destroy (l->pool);
   mem_destroy (l->m, l->len);
+#if FIELD_MAJOR
+  for (real ** d = l->d; d < l->d + datasize/sizeof(real); d++)
+    free (*d);
+  free (l->d);
+  array_free (l->free);
+#endif
   free (l);
 }
 
+#if FIELD_MAJOR
+/**
+The `layer_index()` function returns the index of a new block of `n`
+cells in the field arrays of layer `l`, growing the arrays if
+necessary. The values of the block are initialised to zero. The
+arrays of deleted fields are not allocated (they are NULL). */
+
+static long layer_index (Layer * l, int n)
+{
+  long b;
+  if (l->free->len > 0) {
+    l->free->len -= sizeof(long);
+    b = *((long *)(((char *)l->free->p) + l->free->len));
+  }
+  else {
+    b = l->nb++;
+    if ((b + 1)*n > l->nm) {
+      long nm = max (2*l->nm, (b + 1)*n);
+      for (int i = 0; i < datasize/sizeof(real); i++)
+	if (!_attribute[i].freed)
+	  qrealloc (l->d[i], nm, real);
+      l->nm = nm;
+      l->placed = false;
+    }
+  }
+  for (real ** d = l->d; d < l->d + datasize/sizeof(real); d++)
+    if (*d)
+      memset (*d + b*n, 0, n*sizeof(real));
+  return b*n;
+}
+
+static void layer_index_free (Layer * l, long index, int n)
+{
+  long b = index/n;
+  array_append (l->free, &b, sizeof(long));
+}
+#endif // FIELD_MAJOR
+
 // Tree
 
 typedef struct {
@@ -175,8 +293,11 @@ typedef struct {
   CacheLevel * boundary;  /* boundary indices for each level */
   /* indices of boundary cells with non-boundary parents */
   CacheLevel * restriction;
+  Cache        changed;  /* cells refined or coarsened since the last update */
   
+  long revision;    /* unique identifier of the caches */
   bool dirty;       /* whether caches should be updated */
+  bool masked;      /* whether the domain contains boundary cells */
 } Tree;
 
 #define tree ((Tree *)grid)
@@ -210,12 +331,105 @@ static void cache_level_shrink (CacheLevel * c)
   }
 }
 
+#if MORTON_CACHE
+
+#if dimension == 2
+static inline uint64_t morton_spread (uint64_t x)
+{
+  x &= 0xfffffff;
+  x = (x | x << 16) & 0x0000ffff0000ffff;
+  x = (x | x << 8)  & 0x00ff00ff00ff00ff;
+  x = (x | x << 4)  & 0x0f0f0f0f0f0f0f0f;
+  x = (x | x << 2)  & 0x3333333333333333;
+  x = (x | x << 1)  & 0x5555555555555555;
+  return x;
+}
+
+static inline uint64_t morton_compact (uint64_t x)
+{
+  x &= 0x5555555555555555;
+  x = (x ^ (x >> 1))  & 0x3333333333333333;
+  x = (x ^ (x >> 2))  & 0x0f0f0f0f0f0f0f0f;
+  x = (x ^ (x >> 4))  & 0x00ff00ff00ff00ff;
+  x = (x ^ (x >> 8))  & 0x0000ffff0000ffff;
+  x = (x ^ (x >> 16)) & 0x00000000ffffffff;
+  return x;
+}
+#elif dimension == 3
+static inline uint64_t morton_spread (uint64_t x)
+{
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8)  & 0x100f00f00f00f00f;
+  x = (x | x << 4)  & 0x10c30c30c30c30c3;
+  x = (x | x << 2)  & 0x1249249249249249;
+  return x;
+}
+
+static inline uint64_t morton_compact (uint64_t x)
+{
+  x &= 0x1249249249249249;
+  x = (x ^ (x >> 2))  & 0x10c30c30c30c30c3;
+  x = (x ^ (x >> 4))  & 0x100f00f00f00f00f;
+  x = (x ^ (x >> 8))  & 0x1f0000ff0000ff;
+  x = (x ^ (x >> 16)) & 0x1f00000000ffff;
+  x = (x ^ (x >> 32)) & 0x1fffff;
+  return x;
+}
+#endif // dimension == 3
+
+static inline CacheIndex morton_key (Point p, unsigned short flags)
+{
+  int s = MORTON_BITS - 1 - p.level;
+  uint64_t m = (uint64_t)(p.i - GHOSTS) << s;
+#if dimension == 2
+  m = morton_spread (m) << 1 | morton_spread ((uint64_t)(p.j - GHOSTS) << s);
+#elif dimension == 3
+  m = (morton_spread (m) << 2 |
+       morton_spread ((uint64_t)(p.j - GHOSTS) << s) << 1 |
+       morton_spread ((uint64_t)(p.k - GHOSTS) << s));
+#endif
+  return m << 8 | p.level << 3 | (flags & 7);
+}
+
+static inline Index morton_index (CacheIndex key)
+{
+  Index p;
+  p.flags = key & 7;
+  p.level = (key >> 3) & 31;
+  int s = MORTON_BITS - 1 - p.level;
+  uint64_t m = key >> 8;
+#if dimension == 1
+  p.i = (m >> s) + GHOSTS;
+#elif dimension == 2
+  p.i = (morton_compact (m >> 1) >> s) + GHOSTS;
+  p.j = (morton_compact (m) >> s) + GHOSTS;
+#else // dimension == 3
+  p.i = (morton_compact (m >> 2) >> s) + GHOSTS;
+  p.j = (morton_compact (m >> 1) >> s) + GHOSTS;
+  p.k = (morton_compact (m) >> s) + GHOSTS;
+#endif
+  return p;
+}
+
+# define cache_index(c, n) morton_index ((c)->p[n])
+
+#else // !MORTON_CACHE
+
+# define cache_index(c, n) ((c)->p[n])
+
+#endif // !MORTON_CACHE
+
 static void cache_append (Cache * c, Point p, unsigned short flags)
 {
   if (c->n >= c->nm) {
     c->nm += BSIZE;
-    qrealloc (c->p, c->nm, Index);
+    qrealloc (c->p, c->nm, CacheIndex);
   }
+#if MORTON_CACHE
+  c->p[c->n] = morton_key (p, flags);
+#else
   c->p[c->n].i = p.i;
 #if dimension >= 2
   c->p[c->n].j = p.j;
@@ -225,12 +439,17 @@ static void cache_append (Cache * c, Point p, unsigned short flags)
 #endif  
   c->p[c->n].level = p.level;
   c->p[c->n].flags = flags;
+#endif // !MORTON_CACHE
   c->n++;
 }
 
 void cache_shrink (Cache * c)
 {
-  cache_level_shrink ((CacheLevel *)c);
+  if (c->nm > (c->n/BSIZE + 1)*BSIZE) {
+    c->nm = (c->n/BSIZE + 1)*BSIZE;
+    assert (c->nm > c->n);
+    qrealloc (c->p, c->nm, CacheIndex);
+  }
 }
 
 #undef BSIZE
@@ -313,9 +532,18 @@ void cache_shrink (Cache * c)
 @
 
 /***** Data macros *****/
-@define data(k,l,n)     ((double *) (NEIGHBOR(k,l,n) + sizeof(Cell)))
-@define fine(a,k,p,n)   ((double *) (CHILD(k,p,n) + sizeof(Cell)))[_index(a,n)]
-@define coarse(a,k,p,n) ((double *) (PARENT(k,p,n) + sizeof(Cell)))[_index(a,n)]
+#if FIELD_MAJOR
+@def _field(level,a,c) (tree->L[level]->d[a][CELL(c).index])
+@
+@undef val
+@define val(a,k,l,m)    _field(point.level,_index(a,m),NEIGHBOR(k,l,m))
+@define fine(a,k,p,n)   _field(point.level+1,_index(a,n),CHILD(k,p,n))
+@define coarse(a,k,p,n) _field(point.level-1,_index(a,n),PARENT(k,p,n))
+#else // !FIELD_MAJOR
+@define data(k,l,n)     ((real *) (NEIGHBOR(k,l,n) + sizeof(Cell)))
+@define fine(a,k,p,n)   ((real *) (CHILD(k,p,n) + sizeof(Cell)))[_index(a,n)]
+@define coarse(a,k,p,n) ((real *) (PARENT(k,p,n) + sizeof(Cell)))[_index(a,n)]
+#endif // !FIELD_MAJOR
 
 macro POINT_VARIABLES (Point point = point) {
   VARIABLES();
@@ -403,7 +631,7 @@ macro1 foreach_child (Point point = point, break = (_l = _m = _n = 2)) {
 }
 #endif // dimension == 3
   
-#define update_cache() { if (tree->dirty) update_cache_f(); }
+#define update_cache() { if (tree->dirty || tree->changed.n) update_cache_f(); }
 
 #define is_refined(cell)      (!is_leaf (cell) && cell.neighbors && cell.pid >= 0)
 #define is_prolongation(cell) (!is_leaf(cell) && !cell.neighbors && cell.pid >= 0)
@@ -435,21 +663,22 @@ macro2 foreach_cache (Cache cache, Reduce reductions = None)
     int _k; unsigned short _flags; NOT_UNUSED(_flags);
     OMP(omp for schedule(static))
       for (_k = 0; _k < cache.n; _k++) {
-	point.i = cache.p[_k].i;
+	Index _p = cache_index (&cache, _k);
+	point.i = _p.i;
 #if dimension >= 2
-	point.j = cache.p[_k].j;
+	point.j = _p.j;
 #endif
 #if dimension >= 3
-	point.k = cache.p[_k].k;
+	point.k = _p.k;
 #endif
-	point.level = cache.p[_k].level;
-	_flags = cache.p[_k].flags;
+	point.level = _p.level;
+	_flags = _p.flags;
 	{...}
       }
   }
 }
 
-macro2 foreach_cache_level (Cache cache, int _l, Reduce reductions = None)
+macro2 foreach_cache_level (CacheLevel cache, int _l, Reduce reductions = None)
 {
   OMP_PARALLEL (reductions) {
     int ig = 0, jg = 0, kg = 0; NOT_UNUSED(ig); NOT_UNUSED(jg); NOT_UNUSED(kg);
@@ -551,19 +780,60 @@ static inline void cache_append_face (Point point, unsigned short flags)
 
 #define FBOUNDARY 1 // fixme: this should work with zero
 
-static void update_cache_f (void)
+static inline void cache_append_boundary (Point point, unsigned short fboundary)
+{
+  Tree * q = tree;
+  // look in a 5x5 neighborhood for boundary cells
+  foreach_neighbor (BGHOSTS)
+    if (allocated(0) && is_boundary(cell) && !(cell.flags & fboundary)) {
+      cache_level_append (&q->boundary[level], point);
+      cell.flags |= fboundary;
+    }
+}
+
+static inline void cache_append_leaf (Point point)
+{
+  Tree * q = tree;
+  cache_append (&q->leaves, point, 0);
+  // faces
+  unsigned short flags = 0;
+  foreach_dimension()
+    if (is_boundary(neighbor(-1)) || is_prolongation(neighbor(-1)) ||
+	is_leaf(neighbor(-1)))
+      flags |= face_x;
+  if (flags)
+    cache_append (&q->faces, point, flags);
+  foreach_dimension()
+    if (is_boundary(neighbor(1)) || is_prolongation(neighbor(1)) ||
+	(!is_local(neighbor(1)) && is_leaf(neighbor(1))))
+      cache_append (&q->faces, neighborp(1), face_x);
+  // vertices
+  for (int i = 0; i <= 1; i++)
+  #if dimension >= 2
+    for (int j = 0; j <= 1; j++)
+  #endif
+    #if dimension >= 3
+      for (int k = 0; k <= 1; k++)
+    #endif
+	if (!is_vertex(neighbor(i,j,k))) {
+	  cache_append (&q->vertices, neighborp(i,j,k), 0);
+	  neighbor(i,j,k).flags |= vertex;
+	}
+  // halo prolongation
+  if (cell.neighbors > 0)
+    cache_level_append (&q->prolongation[level], point);
+}
+
+static void update_cache_full (void)
 {
   Tree * q = tree;
 
-  foreach_cache (q->vertices)
-    if (level <= depth() && allocated(0))
-      cell.flags &= ~vertex;
-  
   /* empty caches */
   q->leaves.n = q->faces.n = q->vertices.n = 0;
   for (int l = 0; l <= depth(); l++)
     q->active[l].n = q->prolongation[l].n =
       q->boundary[l].n = q->restriction[l].n = 0;
+  q->masked = false;
 #if FBOUNDARY
   const unsigned short fboundary = 1 << user;
   foreach_cell() {
@@ -591,49 +861,18 @@ static void update_cache_f (void)
     }
 #else
     // boundaries
-    if (!is_boundary(cell)) {
-      // look in a 5x5 neighborhood for boundary cells
-      foreach_neighbor (BGHOSTS)
-	if (allocated(0) && is_boundary(cell) && !(cell.flags & fboundary)) {
-	  cache_level_append (&q->boundary[level], point);
-	  cell.flags |= fboundary;
-	}
-    }
+    if (!is_boundary(cell))
+      cache_append_boundary (point, fboundary);
     // restriction for masked cells
-    else if (level > 0 && is_local(aparent(0)))
-      cache_level_append (&q->restriction[level], point);
+    else {
+      q->masked = true;
+      if (level > 0 && is_local(aparent(0)))
+	cache_level_append (&q->restriction[level], point);
+    }
 #endif
     if (is_leaf (cell)) {
-      if (is_local(cell)) {
-	cache_append (&q->leaves, point, 0);
-	// faces
-	unsigned short flags = 0;
-	foreach_dimension()
-	  if (is_boundary(neighbor(-1)) || is_prolongation(neighbor(-1)) ||
-	      is_leaf(neighbor(-1)))
-	    flags |= face_x;
-	if (flags)
-	  cache_append (&q->faces, point, flags);
-	foreach_dimension()
-	  if (is_boundary(neighbor(1)) || is_prolongation(neighbor(1)) ||
-	      (!is_local(neighbor(1)) && is_leaf(neighbor(1))))
-	    cache_append (&q->faces, neighborp(1), face_x);
-	// vertices
-	for (int i = 0; i <= 1; i++)
-        #if dimension >= 2
-	  for (int j = 0; j <= 1; j++)
-        #endif
-          #if dimension >= 3
-	    for (int k = 0; k <= 1; k++)
-	  #endif
-	      if (!is_vertex(neighbor(i,j,k))) {
-		cache_append (&q->vertices, neighborp(i,j,k), 0);
-		neighbor(i,j,k).flags |= vertex;
-	      }
-	// halo prolongation
-        if (cell.neighbors > 0)
-	  cache_level_append (&q->prolongation[level], point);
-      }
+      if (is_local(cell))
+	cache_append_leaf (point);
       else if (!is_boundary(cell) || is_local(aparent(0))) { // non-local
 	// faces
 	unsigned short flags = 0;
@@ -654,6 +893,461 @@ static void update_cache_f (void)
     }
   }
 
+#if FBOUNDARY
+  for (int l = depth(); l >= 0; l--)
+    foreach_cache_level (q->boundary[l], l)
+      cell.flags &= ~fboundary;
+#endif
+}
+
+/**
+## Incremental cache updates
+
+Rather than traversing the entire tree, the caches can be patched
+using the cells refined or coarsened since the last update (stored in
+`tree->changed` by `increment_neighbors()` and
+`decrement_neighbors()`).
+
+The caches are ordered as the traversal of `foreach_cell()`, i.e. in
+Z-order (with *x* the most significant direction and parents before
+their children). The function below compares two cells in this
+order. */
+
+static int index_compare (const void * pa, const void * pb)
+{
+  const Index * p = pa, * q = pb;
+  int l = max (p->level, q->level), dim = 0;
+  unsigned a[dimension], b[dimension], msb = 0;
+  a[0] = (p->i - GHOSTS) << (l - p->level);
+  b[0] = (q->i - GHOSTS) << (l - q->level);
+#if dimension >= 2
+  a[1] = (p->j - GHOSTS) << (l - p->level);
+  b[1] = (q->j - GHOSTS) << (l - q->level);
+#endif
+#if dimension >= 3
+  a[2] = (p->k - GHOSTS) << (l - p->level);
+  b[2] = (q->k - GHOSTS) << (l - q->level);
+#endif
+  // the direction with the most significant differing bit
+  for (int d = 0; d < dimension; d++) {
+    unsigned x = a[d] ^ b[d];
+    if (msb < x && msb < (msb ^ x))
+      msb = x, dim = d;
+  }
+  if (!msb)
+    return p->level - q->level;
+  return a[dim] < b[dim] ? -1 : 1;
+}
+
+/**
+With `MORTON_CACHE`, the keys directly give this order. */
+
+static int cache_index_compare (const void * pa, const void * pb)
+{
+#if MORTON_CACHE
+  const CacheIndex * a = pa, * b = pb;
+  return *a < *b ? -1 : *a > *b;
+#else
+  return index_compare (pa, pb);
+#endif
+}
+
+/**
+This returns `true` if cell `p` is `root` or one of its descendants. */
+
+static bool index_in_subtree (const Index * p, const Index * root)
+{
+  int s = p->level - root->level;
+  return s >= 0 &&
+    ((p->i - GHOSTS) >> s) == root->i - GHOSTS
+#if dimension >= 2
+    && ((p->j - GHOSTS) >> s) == root->j - GHOSTS
+#endif
+#if dimension >= 3
+    && ((p->k - GHOSTS) >> s) == root->k - GHOSTS
+#endif
+    ;
+}
+
+static inline Index index_level (IndexLevel p, int level)
+{
+  Index i = {0};
+  i.i = p.i;
+#if dimension >= 2
+  i.j = p.j;
+#endif
+#if dimension >= 3
+  i.k = p.k;
+#endif
+  i.level = level;
+  return i;
+}
+
+static inline Point index_point (Index p)
+{
+  Point point = {0};
+  point.i = p.i;
+#if dimension >= 2
+  point.j = p.j;
+#endif
+#if dimension >= 3
+  point.k = p.k;
+#endif
+  point.level = p.level;
+  return point;
+}
+
+/**
+Only cells within `BGHOSTS` of a (non-periodic) side of the domain can
+have boundary cells in their neighborhood (when the domain is not
+masked). */
+
+static bool is_near_boundary (Point point)
+{
+  int n = 1 << point.level;
+  if (!Period.x && (point.i < GHOSTS + BGHOSTS ||
+		    point.i >= GHOSTS + n - BGHOSTS))
+    return true;
+#if dimension >= 2
+  if (!Period.y && (point.j < GHOSTS + BGHOSTS ||
+		    point.j >= GHOSTS + n - BGHOSTS))
+    return true;
+#endif
+#if dimension >= 3
+  if (!Period.z && (point.k < GHOSTS + BGHOSTS ||
+		    point.k >= GHOSTS + n - BGHOSTS))
+    return true;
+#endif
+  return false;
+}
+
+/**
+The changed cells are sorted and only the roots of the modified
+subtrees are kept. The leaves and the active cells of each subtree are
+obtained by traversing the subtree and are spliced into the existing
+caches, which preserves the traversal order. The faces, vertices and
+halo prolongation caches are then rebuilt from the leaves, and the
+boundary caches from the active cells close to the sides of the
+domain. This gives exactly the same caches as `update_cache_full()`.
+
+Masked domains, MPI and large changes (e.g. the initial refinement) use
+a full update. The function returns `false` (without touching the
+caches) in this case. */
+
+static bool update_cache_incremental (void)
+{
+  Tree * q = tree;
+  if (q->masked || q->changed.n == 0 ||
+      q->changed.n*(1 << dimension) > q->leaves.n)
+    return false;
+  
+  qsort (q->changed.p, q->changed.n, sizeof(CacheIndex), cache_index_compare);
+  Index * root = qmalloc (q->changed.n, Index);
+  int nr = 0, lmin = depth();
+  for (int k = 0; k < q->changed.n; k++) {
+    Index * r = &root[nr];
+    *r = cache_index (&q->changed, k);
+    if (nr > 0 && index_in_subtree (r, &root[nr - 1]))
+      continue;
+    if (r->level > depth() ||
+	r->i < GHOSTS || r->i >= GHOSTS + (1 << r->level)
+#if dimension >= 2
+	|| r->j < GHOSTS || r->j >= GHOSTS + (1 << r->level)
+#endif
+#if dimension >= 3
+	|| r->k < GHOSTS || r->k >= GHOSTS + (1 << r->level)
+#endif
+	) {
+      free (root);
+      return false;
+    }
+    Point point = index_point (*r);
+    if (!allocated(0)) {
+      free (root);
+      return false;
+    }
+    nr++;
+    if (r->level < lmin)
+      lmin = r->level;
+  }
+
+  /* splice the leaves and active cells of each subtree */
+  Cache leaves = {0};
+  leaves.nm = q->leaves.nm;
+  leaves.p = qmalloc (leaves.nm, CacheIndex);
+  CacheLevel cactive[depth() + 1];
+  int kactive[depth() + 1], kleaves = 0;
+  for (int l = lmin + 1; l <= depth(); l++) {
+    cactive[l].n = 0;
+    cactive[l].nm = q->active[l].nm;
+    cactive[l].p = qmalloc (cactive[l].nm, IndexLevel);
+    kactive[l] = 0;
+  }
+  for (Index * r = root; r < root + nr; r++) {
+    for (; kleaves < q->leaves.n; kleaves++) {
+      Index p = cache_index (&q->leaves, kleaves);
+      if (index_compare (&p, r) >= 0)
+	break;
+      cache_append (&leaves, index_point (p), 0);
+    }
+    for (; kleaves < q->leaves.n; kleaves++) {
+      Index p = cache_index (&q->leaves, kleaves);
+      if (!index_in_subtree (&p, r))
+	break;
+    }
+    for (int l = r->level + 1; l <= depth(); l++) {
+      CacheLevel * c = &q->active[l];
+      while (kactive[l] < c->n) {
+	Index p = index_level (c->p[kactive[l]], l);
+	if (index_compare (&p, r) >= 0)
+	  break;
+	cache_level_append (&cactive[l], index_point (p));
+	kactive[l]++;
+      }
+      while (kactive[l] < c->n) {
+	Index p = index_level (c->p[kactive[l]], l);
+	if (!index_in_subtree (&p, r))
+	  break;
+	kactive[l]++;
+      }
+    }
+    int rlevel = r->level;
+    foreach_cell_root (index_point (*r)) {
+      if (level > rlevel && is_local(cell) && is_active(cell))
+	cache_level_append (&cactive[level], point);
+      if (is_leaf (cell)) {
+	if (is_local(cell))
+	  cache_append (&leaves, point, 0);
+	continue;
+      }
+    }
+  }
+  free (root);
+  for (; kleaves < q->leaves.n; kleaves++)
+    cache_append (&leaves, index_point (cache_index (&q->leaves, kleaves)), 0);
+  free (q->leaves.p);
+  q->leaves = leaves;
+  for (int l = lmin + 1; l <= depth(); l++) {
+    CacheLevel * c = &q->active[l];
+    while (kactive[l] < c->n)
+      cache_level_append (&cactive[l],
+			  index_point (index_level (c->p[kactive[l]++], l)));
+    free (c->p);
+    *c = cactive[l];
+  }
+
+  /* faces, vertices and halo prolongation */
+  int n = q->leaves.n;
+  q->leaves.n = q->faces.n = q->vertices.n = 0;
+  for (int l = 0; l <= depth(); l++)
+    q->prolongation[l].n = 0;
+  for (int k = 0; k < n; k++)
+    cache_append_leaf (index_point (cache_index (&leaves, k)));
+
+  /* boundaries */
+  const unsigned short fboundary = 1 << user;
+  for (int l = lmin + 1; l <= depth(); l++) {
+    CacheLevel * c = &q->active[l];
+    q->boundary[l].n = 0;
+    for (IndexLevel * p = c->p; p < c->p + c->n; p++) {
+      Point point = index_point (index_level (*p, l));
+      if (is_near_boundary (point))
+	cache_append_boundary (point, fboundary);
+    }
+    c = &q->boundary[l];
+    for (IndexLevel * p = c->p; p < c->p + c->n; p++) {
+      Point point = index_point (index_level (*p, l));
+      cell.flags &= ~fboundary;
+    }
+  }
+  
+  return true;
+}
+
+/* With MEMPOOL_MMAP and OpenMP, the memory of the tree is placed on
+   the NUMA nodes of the threads which use it in foreach() loops, by
+   letting these threads touch it first. The function below returns
+   the thread owning the position of `point` in the static schedule
+   of foreach() over tree->leaves. */
+
+#if MEMPOOL_MMAP && _OPENMP
+static struct {
+  Index * start; // the first leaf of each thread
+  int nt;
+  long revision;
+} leaf_schedule = {NULL, 0, -1};
+
+static int leaf_owner (Point point)
+{
+  Tree * q = tree;
+  int nt = omp_get_max_threads();
+  if (leaf_schedule.revision != q->revision || leaf_schedule.nt != nt) {
+    qrealloc (leaf_schedule.start, nt, Index);
+    long n = q->leaves.n, c = n/nt, r = n % nt;
+    for (int t = 0; t < nt && t < n; t++)
+      leaf_schedule.start[t] = cache_index (&q->leaves, t*c + min(t, r));
+    leaf_schedule.nt = nt;
+    leaf_schedule.revision = q->revision;
+  }
+  int n = min (nt, q->leaves.n);
+  if (n == 0)
+    return -1;
+  Index p = {0};
+  p.i = point.i;
+#if dimension >= 2
+  p.j = point.j;
+#endif
+#if dimension >= 3
+  p.k = point.k;
+#endif
+  p.level = point.level;
+  int s = 0, e = n;
+  while (e - s > 1) {
+    int m = (s + e)/2;
+    if (index_compare (&leaf_schedule.start[m], &p) <= 0)
+      s = m;
+    else
+      e = m;
+  }
+  return s;
+}
+
+/* New pools are touched by the owner of the cell being refined (see
+   alloc_children()). With FIELD_MAJOR, the field arrays of a level are
+   grown (by the master thread) using realloc(). They are then copied
+   into new arrays, the values of the leaves being copied first by
+   the threads which own them. */
+
+#if FIELD_MAJOR
+static void place_field_arrays (void)
+{
+  Tree * q = tree;
+  int nvar = datasize/sizeof(real), nl = 0;
+  real ** d[depth() + 1];
+  for (int l = 0; l <= depth(); l++) {
+    Layer * L = q->L[l];
+    d[l] = NULL;
+    if (!L->placed) {
+      d[l] = qcalloc (nvar + 1, real *);
+      for (int i = 0; i < nvar; i++)
+	if (L->d[i])
+	  d[l][i] = qmalloc (L->nm, real);
+      nl++;
+    }
+  }
+  if (!nl)
+    return;
+  foreach_cache (q->leaves)
+    if (d[level])
+      for (int i = 0; i < nvar; i++)
+	if (d[level][i])
+	  d[level][i][cell.index] = q->L[level]->d[i][cell.index];
+  for (int l = 0; l <= depth(); l++)
+    if (d[l]) {
+      Layer * L = q->L[l];
+      for (int i = 0; i < nvar; i++)
+	if (d[l][i]) {
+	  memcpy (d[l][i], L->d[i], L->nm*sizeof(real));
+	  free (L->d[i]);
+	}
+      free (L->d);
+      L->d = d[l];
+      L->placed = true;
+    }
+}
+#endif // FIELD_MAJOR
+
+/* After adaptation, the leaves owned by each thread change, but the
+   pages which have already been touched stay on their node. The
+   function below re-places the mapped pools: the thread owning most
+   of the leaves of each pool is found using a (streaming) majority
+   vote over the leaves, in the order of the static schedule of
+   foreach(), and the pool is moved onto the node of this thread if it
+   is not already there. Since pools are moved as a whole and only
+   when their majority owner changes, pages shared by several threads
+   do not go back and forth. It is called by adapt_wavelet(). With
+   FIELD_MAJOR, only the pools of cell headers are re-placed: the
+   field arrays are only placed when they grow (see
+   place_field_arrays()). */
+
+void tree_place_memory (void)
+{
+  update_cache();
+  Tree * q = tree;
+  int nt = omp_get_max_threads(), node[nt];
+  for (int i = 0; i < nt; i++)
+    node[i] = -1;
+  OMP (omp parallel)
+    node[omp_get_thread_num()] = mempool_node();
+
+  for (int l = 1; l <= depth(); l++)
+    if (q->L[l]->pool->mapped)
+      for (Pool * p = q->L[l]->pool->pool; p; p = p->next)
+	p->count = 0;
+  long n = q->leaves.n, c = n/nt, r = n % nt;
+  Point point = {0};
+  for (long _k = 0; _k < n; _k++) {
+    Index _p = cache_index (&q->leaves, _k);
+    point.level = _p.level;
+    if (point.level > 0 && q->L[point.level]->pool->mapped) {
+      point.i = _p.i;
+#if dimension >= 2
+      point.j = _p.j;
+#endif
+#if dimension >= 3
+      point.k = _p.k;
+#endif
+      int t = _k < r*(c + 1) ? _k/(c + 1) : r + (_k - r*(c + 1))/c;
+      Pool * p = (Pool *)(((size_t) &cell) & ~((size_t) MEMPOOL_HUGE - 1));
+      if (p->count == 0)
+	p->vote = t, p->count = 1;
+      else
+	p->count += p->vote == t ? 1 : -1;
+    }
+  }
+
+  for (int l = 1; l <= depth(); l++) {
+    Mempool * m = q->L[l]->pool;
+    if (m->mapped)
+      for (Pool * p = m->pool; p; p = p->next)
+	if (p->count > 0 && p->vote != p->owner) {
+	  int from = p->owner < nt ? node[p->owner] : -1;
+	  if (node[p->vote] >= 0 && node[p->vote] != from)
+	    mempool_move (m, p, node[p->vote]);
+	  p->owner = p->vote;
+	}
+  }
+}
+#endif // MEMPOOL_MMAP && _OPENMP
+
+/**
+The number of full and incremental updates, and the time they took, are
+summarized by `timer_print()`. */
+
+struct {
+  long nfull, nincremental;
+  double tfull, tincremental;
+} cache_updates = {0};
+
+static void update_cache_f (void)
+{
+  Tree * q = tree;
+  timer t = timer_start();
+
+  foreach_cache (q->vertices)
+    if (level <= depth() && allocated(0))
+      cell.flags &= ~vertex;
+
+  if (!q->dirty && update_cache_incremental()) {
+    cache_updates.nincremental++;
+    cache_updates.tincremental += timer_elapsed (t);
+  }
+  else {
+    update_cache_full();
+    cache_updates.nfull++;
+    cache_updates.tfull += timer_elapsed (t);
+  }
+  
   /* optimize caches */
   cache_shrink (&q->leaves);
   cache_shrink (&q->faces);
@@ -665,12 +1359,15 @@ static void update_cache_f (void)
     cache_level_shrink (&q->restriction[l]);
 }
   
+  static long revision = 0;
+  q->revision = ++revision;
   q->dirty = false;
+  free (q->changed.p);
+  q->changed.p = NULL;
+  q->changed.n = q->changed.nm = 0;
 
-#if FBOUNDARY
-  for (int l = depth(); l >= 0; l--)
-    foreach_boundary_level (l)
-      cell.flags &= ~fboundary;
+#if MEMPOOL_MMAP && _OPENMP && FIELD_MAJOR
+  place_field_arrays();
 #endif
   
   // mesh size
@@ -756,13 +1453,20 @@ macro2 foreach_level_or_leaf (int l, char flags = 0, Reduce reductions = None) {
 @ define trash(list) reset(list, undefined)
 @endif
 
-void reset (void * alist, double val)
+void reset (void * alist, real val)
 {
   scalar * list = (scalar *) alist;
   Tree * q = tree;
   /* low-level memory management */
   for (int l = 0; l <= depth(); l++) {
     Layer * L = q->L[l];
+#if FIELD_MAJOR
+    for (scalar s in list)
+      if (!is_constant(s))
+	for (int b = 0; b < s.block; b++)
+	  for (real * v = L->d[s.i + b], * end = v + L->nm; v < end; v++)
+	    *v = val;
+#else
     foreach_mem (L->m, L->len, 1) {
       point.level = l;
       for (scalar s in list) {
@@ -771,6 +1475,7 @@ void reset (void * alist, double val)
 	    data(0,0,0)[s.i + b] = val;
       }
     }
+#endif
   }
 }
 
@@ -786,6 +1491,9 @@ static void update_depth (int inc)
 {
   Tree * q = tree;
   grid->depth += inc;
+#if MORTON_CACHE
+  assert (grid->depth <= MORTON_MAXLEVEL);
+#endif
   q->L = &(q->L[-1]);
   qrealloc (q->L, grid->depth + 2, Layer *);
   q->L = &(q->L[1]);
@@ -795,6 +1503,7 @@ static void update_depth (int inc)
   q->prolongation = cache_level_resize (q->prolongation, inc);
   q->boundary = cache_level_resize (q->boundary, inc);
   q->restriction = cache_level_resize (q->restriction, inc);
+  q->dirty = true;
 }
 
 #if dimension == 1
@@ -947,8 +1656,17 @@ static void alloc_children (Point point)
   /* low-level memory management */
   Layer * L = tree->L[point.level + 1];
   L->nc++;
-  size_t len = sizeof(Cell) + datasize;
+  size_t len = cell_size();
+#if MEMPOOL_MMAP && _OPENMP
+  if (mempool_full (L->pool))
+    L->pool->owner = leaf_owner (point);
+#endif
   char * b = (char *) mempool_alloc0 (L->pool);
+#if FIELD_MAJOR
+  long index = layer_index (L, 1 << dimension);
+  for (char * c = b; c < b + (1 << dimension)*len; c += len)
+    CELL(c).index = index++;
+#endif
   int i = 2*point.i - GHOSTS;
   for (int k = 0; k < 2; k++, i++) {
 #if dimension == 1
@@ -989,6 +1707,9 @@ static void free_children (Point point)
   Layer * L = tree->L[point.level + 1];
   int i = 2*point.i - GHOSTS;
   assert (mem_data (L->m,i));
+#if FIELD_MAJOR
+  layer_index_free (L, CELL(mem_data (L->m,i)).index, 1 << dimension);
+#endif
   mempool_free (L->pool, mem_data (L->m,i));
   for (int k = 0; k < 2; k++, i++)
     free_periodic (L->m, i, L->len);
@@ -1005,6 +1726,9 @@ static void free_children (Point point)
   Layer * L = tree->L[point.level + 1];
   int i = 2*point.i - GHOSTS, j = 2*point.j - GHOSTS;
   assert (mem_data (L->m,i,j));
+#if FIELD_MAJOR
+  layer_index_free (L, CELL(mem_data (L->m,i,j)).index, 1 << dimension);
+#endif
   mempool_free (L->pool, mem_data (L->m,i,j));
   for (int k = 0; k < 2; k++)
     for (int l = 0; l < 2; l++)
@@ -1022,6 +1746,11 @@ static void free_children (Point point)
   Layer * L = tree->L[point.level + 1];
   int i = 2*point.i - GHOSTS;
   assert (mem_data (L->m,i,2*point.j - GHOSTS,2*point.k - GHOSTS));
+#if FIELD_MAJOR
+  layer_index_free (L, CELL(mem_data (L->m,
+				      i,2*point.j - GHOSTS,2*point.k - GHOSTS)).index,
+		    1 << dimension);
+#endif
   mempool_free (L->pool, mem_data (L->m,
 				   i,2*point.j - GHOSTS,2*point.k - GHOSTS));
   for (int k = 0; k < 2; k++, i++) {
@@ -1040,9 +1769,23 @@ static void free_children (Point point)
 }
 #endif // dimension == 3
 
-void increment_neighbors (Point point)
+/**
+The cells refined or coarsened are recorded, so that the caches can be
+updated incrementally. With MPI, the caches are always fully updated. */
+
+static void cache_changed (Point point)
 {
+@if _MPI
   tree->dirty = true;
+@else
+  if (!tree->dirty)
+    cache_append (&tree->changed, point, 0);
+@endif
+}
+
+void increment_neighbors (Point point)
+{
+  cache_changed (point);
   if (cell.neighbors++ == 0)
     alloc_children (point);
   foreach_neighbor (GHOSTS/2)
@@ -1053,7 +1796,7 @@ void increment_neighbors (Point point)
 
 void decrement_neighbors (Point point)
 {
-  tree->dirty = true;
+  cache_changed (point);
   foreach_neighbor (GHOSTS/2)
     if (allocated(0)) {
       cell.neighbors--;
@@ -1069,6 +1812,52 @@ void decrement_neighbors (Point point)
   }
 }
 
+#if FIELD_MAJOR
+void realloc_scalar (int size)
+{
+  /* low-level memory management */
+  Tree * q = tree;
+  int nvar = datasize/sizeof(real);
+  datasize += size;
+  /* only the new field arrays need to be allocated: the cells are
+     unchanged */
+  for (int l = 0; l <= depth(); l++) {
+    Layer * L = q->L[l];
+    qrealloc (L->d, datasize/sizeof(real) + 1, real *);
+    for (real ** d = L->d + nvar; d < L->d + datasize/sizeof(real); d++)
+      *d = L->nm > 0 ? qcalloc (L->nm, real) : NULL;
+  }
+}
+
+/**
+The arrays of a deleted field are freed on each level, and those of a
+new field are allocated, so that temporary fields (e.g. `scalar
+flux[]` within a function) only use memory until the end of the block
+which declares them. Reusing the freed arrays for the next temporary
+field is left to the system allocator. */
+
+void free_scalar_data (scalar s)
+{
+  for (int l = 0; l <= depth(); l++) {
+    Layer * L = tree->L[l];
+    for (int b = 0; b < s.block; b++) {
+      free (L->d[s.i + b]);
+      L->d[s.i + b] = NULL;
+    }
+  }
+}
+
+void alloc_scalar_data (scalar s)
+{
+  for (int l = 0; l <= depth(); l++) {
+    Layer * L = tree->L[l];
+    if (L->nm > 0)
+      for (int b = 0; b < s.block; b++)
+	if (!L->d[s.i + b])
+	  L->d[s.i + b] = qmalloc (L->nm, real);
+  }
+}
+#else // !FIELD_MAJOR
 void realloc_scalar (int size)
 {
   /* low-level memory management */
@@ -1127,6 +1916,126 @@ void realloc_scalar (int size)
     mempool_destroy (oldpool);
   }
 }
+#endif // !FIELD_MAJOR
+
+/* Freed blocks are kept by the memory pools for later reuse, so that
+   the memory used after coarsening remains that of the finest mesh.
+   The function below moves the blocks of layer L into a new (compact)
+   pool, updating the memory index, and releases the old pools. With
+   FIELD_MAJOR, the blocks are also renumbered contiguously, so that
+   the field arrays of the layer shrink to the number of cells. */
+
+static void compact_layer (Layer * L)
+{
+  size_t len = cell_size();
+  Mempool * oldpool = L->pool;
+  L->pool = mempool_new (oldpool->poolsize - sizeof(Pool), oldpool->size);
+#if FIELD_MAJOR
+  int nvar = datasize/sizeof(real);
+  real ** d = qcalloc (nvar + 1, real *);
+  for (int i = 0; i < nvar; i++)
+    if (L->d[i])
+      d[i] = qmalloc (L->nc << dimension, real);
+  long index = 0;
+#endif
+  foreach_mem (L->m, L->len, 2) {
+    char * new = (char *) mempool_alloc (L->pool);
+#if dimension == 1
+    for (int k = 0; k < 2; k++) {
+      memcpy (new, mem_data (L->m, point.i + k), len);
+      assign_periodic (L->m, point.i + k, L->len, new);
+      new += len;
+    }
+#elif dimension == 2
+    for (int k = 0; k < 2; k++)
+      for (int o = 0; o < 2; o++) {
+	memcpy (new, mem_data (L->m, point.i + k, point.j + o), len);
+	assign_periodic (L->m, point.i + k, point.j + o, L->len, new);
+	new += len;
+      }
+#else // dimension == 3
+    for (int l = 0; l < 2; l++)
+      for (int m = 0; m < 2; m++)
+	for (int n = 0; n < 2; n++) {
+	  memcpy (new, mem_data (L->m, point.i + l, point.j + m, point.k + n),
+		  len);
+	  assign_periodic (L->m, point.i + l, point.j + m, point.k + n,
+			   L->len, new);
+	  new += len;
+	}
+#endif // dimension == 3
+#if FIELD_MAJOR
+    for (char * c = new - (1 << dimension)*len; c < new; c += len, index++) {
+      for (int i = 0; i < nvar; i++)
+	if (d[i])
+	  d[i][index] = L->d[i][CELL(c).index];
+      CELL(c).index = index;
+    }
+#endif
+  }
+  mempool_destroy (oldpool);
+#if FIELD_MAJOR
+  for (int i = 0; i < nvar; i++)
+    free (L->d[i]);
+  free (L->d);
+  L->d = d;
+  L->nm = index, L->nb = index >> dimension;
+  L->free->len = 0;
+  L->placed = false;
+#endif
+}
+
+/* The layers which use less than tree_min_occupancy of their pools
+   (or, with FIELD_MAJOR, of their field arrays) are compacted by
+   tree_compact(), which is called by adapt_wavelet() and unrefine()
+   after coarsening. Compaction is disabled by default (i.e. if
+   tree_min_occupancy is zero). Setting it to e.g. 0.5 returns the
+   memory of coarsened regions to the system, at the cost of copying
+   the sparsely-used layers. */
+
+double tree_min_occupancy = 0.;
+
+@if _GNU_SOURCE
+@include <malloc.h>
+@endif
+
+bool tree_compact (void)
+{
+  if (!tree_min_occupancy)
+    return false;
+  bool compacted = false;
+  for (int l = 1; l <= depth(); l++) {
+    Layer * L = tree->L[l];
+    if ((L->pool->pool != L->pool->last &&
+	 L->nc < tree_min_occupancy*mempool_capacity (L->pool))
+#if FIELD_MAJOR
+	|| L->nc < tree_min_occupancy*L->nb
+#endif
+	) {
+      compact_layer (L);
+      compacted = true;
+    }
+  }
+@if _GNU_SOURCE
+  // return the memory freed by (non-mmapped) pools to the system
+  if (compacted)
+    malloc_trim (0);
+@endif
+  return compacted;
+}
+
+/* The occupancy of the pools of all layers (of this process). */
+
+double tree_occupancy (void)
+{
+  double used = 0., total = 0.;
+  for (int l = 1; l <= depth(); l++) {
+    Layer * L = tree->L[l];
+    used += L->nc;
+    total += mempool_capacity (L->pool);
+  }
+  return total ? used/total : 1.;
+}
 
 /* Boundaries */
 
@@ -1469,6 +2378,7 @@ void free_grid (void)
   free (q->faces.p);
   free (q->vertices.p);
   free (q->refined.p);
+  free (q->changed.p);
   /* low-level memory management */
   /* the root level is allocated differently */
   Layer * L = q->L[0];
@@ -1489,12 +2399,25 @@ void free_grid (void)
   free_cache (q->prolongation);
   free_cache (q->boundary);
   free_cache (q->restriction);
+#if MEMPOOL_MMAP && _OPENMP
+  free (leaf_schedule.start);
+  leaf_schedule.start = NULL, leaf_schedule.revision = -1;
+#endif
   free (q);
   grid = NULL;
 }
 
 static void refine_level (int depth);
 
+static char * new_root_cell (Layer * L)
+{
+  char * c = (char *) calloc (1, cell_size());
+#if FIELD_MAJOR
+  CELL(c).index = layer_index (L, 1);
+#endif
+  return c;
+}
+
 trace
 void init_grid (int n)
 {
@@ -1524,8 +2447,7 @@ void init_grid (int n)
   q->L[0] = L;
 #if dimension == 1
   for (int i = Period.x*GHOSTS; i < L->len - Period.x*GHOSTS; i++)
-    assign_periodic (L->m, i, L->len, 
-		     (char *) calloc (1, sizeof(Cell) + datasize));
+    assign_periodic (L->m, i, L->len, new_root_cell (L));
   CELL(mem_data (L->m,GHOSTS)).flags |= leaf;
   if (pid() == 0)
     CELL(mem_data (L->m,GHOSTS)).flags |= active;
@@ -1538,7 +2460,7 @@ void init_grid (int n)
   for (int i = Period.x*GHOSTS; i < L->len - Period.x*GHOSTS; i++)
     for (int j = Period.y*GHOSTS; j < L->len - Period.y*GHOSTS; j++)
       assign_periodic (L->m, i, j, L->len,
-		       (char *) calloc (1, sizeof(Cell) + datasize));
+		       new_root_cell (L));
   CELL(mem_data (L->m,GHOSTS,GHOSTS)).flags |= leaf;
   if (pid() == 0)
     CELL(mem_data (L->m,GHOSTS,GHOSTS)).flags |= active;
@@ -1556,7 +2478,7 @@ void init_grid (int n)
     for (int j = Period.y*GHOSTS; j < L->len - Period.y*GHOSTS; j++)
       for (int k = Period.z*GHOSTS; k < L->len - Period.z*GHOSTS; k++)
 	assign_periodic (L->m, i, j, k, L->len,
-			 (char *) calloc (1, sizeof(Cell) + datasize));
+			 new_root_cell (L));
   CELL(mem_data (L->m,GHOSTS,GHOSTS,GHOSTS)).flags |= leaf;
   if (pid() == 0)
     CELL(mem_data (L->m,GHOSTS,GHOSTS,GHOSTS)).flags |= active;
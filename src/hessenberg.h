@@ -76,3 +76,43 @@ void solve_hessenberg (double H[nl*nl], double x[nl])
   }
   x[nl-1] = tau1;
 }
+
+/**
+## Column-major storage
+
+The algorithm above accesses $H$ column by column, from the last
+column to the first. With the row-major storage of
+`solve_hessenberg()`, the inner loop thus accesses memory with a
+stride of $n$, which prevents its vectorisation and wastes cache
+bandwidth when $n$ is large (for example the 50 to 100 layers of ocean
+simulations).
+
+The function below is otherwise identical, but takes $H$ in
+column-major order i.e. $H_{ij} = H[jn+i]$, so that all the inner
+loops access contiguous memory. Note also that only the upper
+Hessenberg part of $H$ (i.e. $H_{ij}$ for $i \leq j + 1$) is used, so
+that the other elements do not need to be initialised. */
+
+void solve_hessenberg_by_columns (double H[nl*nl], double x[nl])
+{
+  double v[nl], c[nl], s[nl];
+  for (int i = 0; i < nl; i++)
+    v[i] = H[nl*(nl - 1) + i];
+  for (int k = nl - 1; k >= 1; k--) {
+    double * h = H + (k - 1)*nl, a = h[k];
+    givens (v[k], a, &c[k], &s[k]);
+    x[k] /= c[k]*v[k] - s[k]*a;
+    double ck = c[k], sk = s[k], ykck = x[k]*ck, yksk = x[k]*sk;
+    for (int l = 0; l < k; l++) {
+      x[l] -= ykck*v[l] - yksk*h[l];
+      v[l] = ck*h[l] + sk*v[l];
+    }
+  }
+  double tau1 = x[0]/v[0];
+  for (int k = 1; k < nl; k++) {
+    double tau2 = x[k];
+    x[k-1] = c[k]*tau1 - s[k]*tau2;
+    tau1 = c[k]*tau2 + s[k]*tau1;
+  }
+  x[nl-1] = tau1;
+}
@@ -88,7 +88,10 @@ the non-hydrostatic pressure $\phi$ is expressed as an [Hessenberg
 matrix](https://en.wikipedia.org/wiki/Hessenberg_matrix) for each column.
 
 The Hessenberg matrix $\mathbf{H}$ for a column at a particular *point* is
-stored in a one-dimensional array with `nl*nl` elements. It encodes
+stored in a one-dimensional array with `nl*nl` elements, in
+column-major order (i.e. $H_{lk}$ is `H[k*nl + l]`) so that the
+[solver](/src/hessenberg.h#column-major-storage) accesses contiguous
+memory. Only the upper Hessenberg part of the matrix is set. It encodes
 the coefficients of the left-hand-side of the Poisson equation as
 $$
 \begin{aligned}
@@ -119,11 +122,42 @@ static void box_matrix (Point point, scalar phi, scalar rhs,
   foreach_layer()
     foreach_dimension()
       dz.x += h[] - h[-1], dzp.x += h[1] - h[];
+
+  /**
+  The coefficients of the sum above only depend on the layer
+  thicknesses of the column. For $k > l$ (where $l$ and $k$ are the
+  indices of the rows and columns of $\mathbf{H}$, i.e. in reverse
+  order of the layers), $H_{lk} = q_l g_k$ with
+  $$
+  q_l = (-1)^{l + 1} h_l, \quad
+  g_k = 8 (-1)^k \left( \frac{1}{h_k} + \frac{1}{h_{k + 1}} \right)
+  $$
+  where dry layers are ignored and $1/h_{\text{nl}} = 0$. The upper
+  triangular part of $\mathbf{H}$ is thus the outer product of $q$
+  and $g$, which is computed column by column and only requires
+  $O(\text{nl})$ divisions. */
+
+  double q[nl], ih[nl + 1];
+  ih[nl] = 0.;
+  for (int l = 0; l < nl; l++) {
+    double hl = h[0,0,nl-1-l];
+    q[l] = l % 2 ? hl : - hl;
+    ih[l] = hl > dry ? 8./hl : 0.;
+  }
+  for (int k = 1; k < nl; k++) {
+    double g = (k % 2 ? - 1. : 1.)*(ih[k] + ih[k + 1]);
+    for (int l = 0; l < k; l++)
+      H[k*nl + l] = q[l]*g;
+  }
+
+  /**
+  The diagonal and subdiagonal coefficients and the right-hand-side
+  are computed for each layer. */
+
   for (int l = 0, m = nl - 1; l < nl; l++, m--) {
     double a = h[0,0,m]/(sq(Delta)*cm[]);
     d[l] = rhs[0,0,m];
-    for (int k = 0; k < nl; k++)
-      H[l*nl + k] = 0.;
+    H[l*nl + l] = - 4. - h[0,0,m]*ih[l + 1];
     foreach_dimension() {
       double s = Delta*slope_limited((dz.x - h[0,0,m] + h[-1,0,m])/Delta);
       double sp = Delta*slope_limited((dzp.x - h[1,0,m] + h[0,0,m])/Delta);
@@ -134,25 +168,17 @@ static void box_matrix (Point point, scalar phi, scalar rhs,
       H[l*nl + l] -= a*(gmetric(0)*(h[0,0,m] + s) +
 			gmetric(1)*(h[0,0,m] - sp));
     }
-    H[l*nl + l] -= 4.;
     if (l > 0) {
-      H[l*(nl + 1) - 1] = 4.;
+      H[(l - 1)*nl + l] = 4.;
       foreach_dimension() {
         double s = Delta*slope_limited(dz.x/Delta);
         double sp = Delta*slope_limited(dzp.x/Delta);
 	d[l] -= a*(gmetric(0)*(h[-1,0,m] + s)*phi[-1,0,m+1] +
 		   gmetric(1)*(h[1,0,m] - sp)*phi[1,0,m+1]);
-	H[l*(nl + 1) - 1] -= a*(gmetric(0)*(h[0,0,m] - s) +
+	H[(l - 1)*nl + l] -= a*(gmetric(0)*(h[0,0,m] - s) +
 				gmetric(1)*(h[0,0,m] + sp));
       }
     }
-    for (int k = l + 1, s = -1; k < nl; k++, s = -s) {
-      double hk = h[0,0,nl-1-k];
-      if (hk > dry) {
-	H[l*nl + k] -= 8.*s*h[0,0,m]/hk;
-	H[l*nl + k - 1] += 8.*s*h[0,0,m]/hk;
-      }
-    }
     foreach_dimension()
       dz.x -= h[0,0,m] - h[-1,0,m], dzp.x -= h[1,0,m] - h[0,0,m];
   }
@@ -191,7 +217,7 @@ static void relax_nh (scalar * phil, scalar * rhsl, int lev, void * data)
 
     double H[nl*nl], b[nl];
     box_matrix (point, phi, rhs, hf, eta, H, b);
-    solve_hessenberg (H, b);
+    solve_hessenberg_by_columns (H, b);
     int l = nl - 1;
     foreach_layer()
       phi[] = b[l--];
@@ -0,0 +1,102 @@
+/**
+# Adaptive tolerance of the multigrid solvers
+
+By default, the Poisson problems of the [centered Navier--Stokes
+solver](centered.h) (and the implicit viscous problem) are solved with
+the same, constant, [*TOLERANCE*](/src/poisson.h#mgstats). This
+tolerance must be small enough to resolve the transients of the flow
+accurately, so that it is usually much too small when the flow evolves
+slowly: the solver then reduces the residual much below the change of
+the solution during one timestep (i.e. below the error of the time
+discretisation).
+
+Including this file sets the tolerance of each solver, at each
+timestep, as a fraction *TOLERANCE_FACTOR* of the initial residual of
+the same solver at the previous timestep, i.e. of the divergence of
+the flow created during one timestep (for the projections). As for
+*TOLERANCE*, the residuals of the projections are scaled by $\Delta
+t^2$ so that the tolerances are relative changes in volume of a cell
+during one timestep, whatever the timestep.
+
+The tolerance is bounded by *TOLERANCE_MIN* and *TOLERANCE_MAX*. By
+default, these are *TOLERANCE* (so that the solvers are never more
+accurate than without this file) and the larger of *TOLERANCE* and
+$10^{-3}$ (the default tolerance). They are set at the start of the
+simulation, if they are not set by the user.
+
+The tolerances used for the projection, the (approximate) projection
+of the advection velocity and the viscous problem are stored in
+*tolp*, *tolpf* and *tolu* respectively. They are logged by
+[perfs.h](perfs.h) if it is included after this file. */
+
+#define ADAPTIVE_TOLERANCE 1
+
+double TOLERANCE_MIN = 0. [*], TOLERANCE_MAX = 0. [*];
+double TOLERANCE_FACTOR = 0.1;
+double tolp = 0. [*], tolpf = 0. [*], tolu = 0. [*];
+
+/**
+The tolerance set by the user is restored after each solution, so that
+the other solvers are not affected. */
+
+static double tolerance_user = 0. [*];
+
+event defaults (i = 0)
+{
+  if (!TOLERANCE_MIN)
+    TOLERANCE_MIN = TOLERANCE;
+  if (!TOLERANCE_MAX)
+    TOLERANCE_MAX = max (TOLERANCE, 1e-3);
+  tolp = tolpf = tolu = TOLERANCE_MIN;
+}
+
+/**
+The new tolerance is computed from the (scaled) initial residual of
+the previous solution. */
+
+static double adapted_tolerance (mgstats s, double scale)
+{
+  double tolerance = TOLERANCE_FACTOR*s.resb*scale;
+  return min (TOLERANCE_MAX, max (TOLERANCE_MIN, tolerance));
+}
+
+/**
+The tolerances are set, and the statistics of the solvers are used,
+using the [event inheritance mechanism](/Basilisk C#event-inheritance)
+i.e. before the corresponding events of [centered.h](centered.h). The
+tolerance of the projections is divided by $\Delta t^2$ by
+[project()](/src/poisson.h#project), so that *TOLERANCE* is set
+directly. */
+
+event advection_term (i++)
+{
+  tolerance_user = TOLERANCE;
+  if (!stokes)
+    TOLERANCE = tolpf;
+}
+
+event viscous_term (i++)
+{
+  if (!stokes)
+    tolpf = adapted_tolerance (mgpf, sq(dt/2.));
+  TOLERANCE = constant(mu.x) != 0. ? tolu : tolerance_user;
+}
+
+event acceleration (i++)
+{
+  if (constant(mu.x) != 0.)
+    tolu = adapted_tolerance (mgu, 1.);
+  TOLERANCE = tolerance_user;
+}
+
+event projection (i++)
+{
+  tolerance_user = TOLERANCE;
+  TOLERANCE = tolp;
+}
+
+event end_timestep (i++)
+{
+  tolp = adapted_tolerance (mgp, sq(dt));
+  TOLERANCE = tolerance_user;
+}
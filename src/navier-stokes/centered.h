@@ -465,5 +465,7 @@ event adapt (i++,last) {
 ## See also
 
 * [Double projection](double-projection.h)
+* [Temporal extrapolation of the pressure](pressure-extrapolation.h)
+* [Adaptive tolerance of the multigrid solvers](adaptive-tolerance.h)
 * [Performance monitoring](perfs.h)
 */
@@ -9,12 +9,25 @@ event perfs (i += 1) {
   if (i == 0)
     fprintf (fp,
 	     "t dt mgp.i mgp.nrelax mgpf.i mgpf.nrelax mgu.i mgu.nrelax "
-	     "grid->tn perf.t perf.speed npe perf.ispeed\n");
+	     "grid->tn perf.t perf.speed npe perf.ispeed"
+#if ADAPTIVE_TOLERANCE
+	     " tolp tolpf tolu"
+#endif
+	     "\n");
   static double start = 0.;
   if (i > 10 && perf.t - start < 1.) return 0;
-  fprintf (fp, "%g %g %d %d %d %d %d %d %ld %g %g %d %g\n", 
+  fprintf (fp, "%g %g %d %d %d %d %d %d %ld %g %g %d %g", 
 	   t, dt, mgp.i, mgp.nrelax, mgpf.i, mgpf.nrelax, mgu.i, mgu.nrelax,
 	   grid->tn, perf.t, perf.speed, npe(), perf.ispeed);
+
+  /**
+  The tolerances of the solvers are added when they are
+  [adaptive](adaptive-tolerance.h). */
+
+#if ADAPTIVE_TOLERANCE
+  fprintf (fp, " %g %g %g", tolp, tolpf, tolu);
+#endif
+  fputc ('\n', fp);
   fflush (fp);
   start = perf.t;
 }
@@ -0,0 +1,89 @@
+/**
+# Temporal extrapolation of the pressure
+
+By default, the [centered Navier--Stokes solver](centered.h) uses the
+pressure of the previous timestep as initial guess for the solution of
+the Poisson equation of the [projection](centered.h#projection). When
+the flow evolves slowly (for example when approaching a steady state),
+a better initial guess is obtained by extrapolating the pressures of
+the previous timesteps to the new time. This reduces the initial
+residual of the Poisson solver and thus the number of multigrid
+iterations.
+
+The order of the extrapolation is set by *PRESSURE_EXTRAPOLATION*:
+zero for none, one for linear extrapolation (using the last two
+pressures) and two for quadratic extrapolation (using the last three
+pressures). The default is linear extrapolation, which is less
+sensitive to noise (for example due to mesh adaptation) than quadratic
+extrapolation.
+
+The history of the pressure is stored in two fields, which are
+restricted and prolongated with the mesh, like any other field. */
+
+int PRESSURE_EXTRAPOLATION = 1;
+
+scalar ph1[], ph2[];
+
+/**
+*ph_time* are the times of the previous pressures and *ph_n* the
+number of projections performed since the start of the simulation. */
+
+static double ph_time[2];
+static int ph_n = 0;
+
+event defaults (i = 0)
+{
+  ph_n = 0;
+  ph1.nodump = ph2.nodump = true;
+}
+
+/**
+The extrapolation is done using the [event inheritance
+mechanism](/Basilisk C#event-inheritance) i.e. before the projection
+of [centered.h](centered.h#projection). The history fields get the
+attributes (boundary conditions, restriction and prolongation
+operators) of the pressure, once, except *nodump* since they are not
+needed for restarts. */
+
+event projection (i++)
+{
+  if (ph_n == 0) {
+    scalar_clone (ph1, p);
+    scalar_clone (ph2, p);
+    ph1.nodump = ph2.nodump = true;
+  }
+
+  /**
+  At this point the pressure is the solution at time $t$, *ph1* the
+  solution at time $t_1$ and *ph2* the solution at time $t_2$. We
+  compute the weights of the Lagrange polynomial interpolating the
+  (available) previous pressures at time $t + \Delta t$. */
+
+  int order = min (PRESSURE_EXTRAPOLATION, ph_n - 1);
+  double w0 = 1., w1 = 0., w2 = 0.;
+  if (order == 1) {
+    w1 = dt/(ph_time[0] - t);
+    w0 = 1. - w1;
+  }
+  else if (order >= 2) {
+    double t0 = t, t1 = ph_time[0], t2 = ph_time[1], tn = t + dt;
+    w0 = (tn - t1)*(tn - t2)/((t0 - t1)*(t0 - t2));
+    w1 = (tn - t0)*(tn - t2)/((t1 - t0)*(t1 - t2));
+    w2 = (tn - t0)*(tn - t1)/((t2 - t0)*(t2 - t1));
+  }
+
+  /**
+  We then update the history and replace the pressure with the
+  extrapolated value. */
+
+  if (ph_n > 0) {
+    foreach() {
+      double p0 = p[];
+      p[] = w0*p0 + w1*ph1[] + w2*ph2[];
+      ph2[] = ph1[];
+      ph1[] = p0;
+    }
+    ph_time[1] = ph_time[0], ph_time[0] = t;
+  }
+  ph_n++;
+}
@@ -1,11 +1,14 @@
 /**
-# Performance monitoring */
+# Performance monitoring
+
+The last column is the fraction of the memory pools of tree grids
+which is used (see `tree_compact()` in [tree.h](/src/grid/tree.h)). */
 
 event perfs (i += 1) {
   static FILE * fp = fopen ("perfs", "w");
   if (i == 0)
     fprintf (fp,
-	     "t dt grid->tn perf.t perf.speed npe perf.ispeed maxrss\n");
+	     "t dt grid->tn perf.t perf.speed npe perf.ispeed maxrss occupancy\n");
   static double start = 0.;
   if (i > 10 && perf.t - start < 1.) return 0;
   fprintf (fp, "%g %g %ld %g %g %d %g ",
@@ -14,10 +17,15 @@ event perfs (i += 1) {
 @if _GNU_SOURCE
   struct rusage usage;
   getrusage (RUSAGE_SELF, &usage);
-  fprintf (fp, "%ld\n", usage.ru_maxrss);
+  fprintf (fp, "%ld ", usage.ru_maxrss);
 @else
-  fputs ("0\n", fp);
+  fputs ("0 ", fp);
 @endif
+#if TREE
+  fprintf (fp, "%g\n", tree_occupancy());
+#else
+  fputs ("1\n", fp);
+#endif
   fflush (fp);
   start = perf.t;
 }
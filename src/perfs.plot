@@ -7,6 +7,7 @@ speed = 5
 npe = 6
 ispeed = 7
 mem = 8
+occupancy = 9
 
 # "infinite" loop
 do for [i=0:1000000] {
@@ -0,0 +1,444 @@
+/**
+# FFT solver for the Poisson--Helmholtz equation
+
+On uniform grids ([Cartesian](/src/grid/cartesian.h) or
+[multigrid](/src/grid/multigrid.h)) and for constant coefficients,
+the discrete [Poisson--Helmholtz operator](poisson.h) is diagonalised
+by discrete Fourier transforms. The equation
+$$
+\nabla\cdot (\alpha\nabla a) + \lambda a = b
+$$
+can then be solved directly, using Fast Fourier Transforms (FFTs),
+with a cost of $O(N\log N)$, rather than iteratively with the
+multigrid solver. This is typically several times faster for
+homogeneous turbulence simulations in periodic boxes.
+
+Including this file is enough to replace the multigrid solver with
+the FFT solver, for all the calls to [poisson()](poisson.h#user-interface)
+(and thus [project()](poisson.h#projection-of-a-velocity-field))
+for which this is possible i.e. when:
+
+* the grid is uniform, and the number of cells in each direction is
+  a power of two,
+* $\alpha$ and $\lambda$ are [constant fields](/Basilisk
+  C#constant-fields) (the components of $\alpha$ can be different),
+* the boundary conditions on each pair of opposite boundaries are
+  either periodic, or of the same type (Neumann or Dirichlet, with
+  arbitrary values),
+* embedded boundaries are not used.
+
+In all the other cases (and also with MPI or on GPUs), the multigrid
+solver is used. The FFT solver can also be turned off by setting
+`poisson_direct` to `NULL`.
+
+The FFTs are self-contained (no external library is required). */
+
+#include "poisson.h"
+
+/**
+## Fast Fourier Transform
+
+This is the classical iterative radix-2 algorithm, for complex data
+of length *n* (a power of two) stored in *re* and *im*. The
+(precomputed) twiddle factors are $w_k = e^{2i\pi\,sign\,k/n}$, with
+*sign* = -1 for the forward transform. The inverse transform (*sign* =
+1) is not normalised. The "half-angle" factors
+$e^{i\pi k/n}$ are used by the real transforms below. */
+
+typedef struct {
+  int n;             // the length of the complex transform
+  double * c, * s;   // the twiddle factors
+  double * hc, * hs; // the half-angle factors
+  double * re, * im; // the data
+} FFTPlan;
+
+static FFTPlan fft_plan (int n)
+{
+  FFTPlan p = { n };
+  p.c = qmalloc (n/2 + 1, double);
+  p.s = qmalloc (n/2 + 1, double);
+  p.hc = qmalloc (n/2 + 1, double);
+  p.hs = qmalloc (n/2 + 1, double);
+  p.re = qmalloc (n, double);
+  p.im = qmalloc (n, double);
+  for (int k = 0; k <= n/2; k++) {
+    p.c[k] = cos (2.*pi*k/n), p.s[k] = sin (2.*pi*k/n);
+    p.hc[k] = cos (pi*k/n), p.hs[k] = sin (pi*k/n);
+  }
+  return p;
+}
+
+static void fft_plan_free (FFTPlan * p)
+{
+  free (p->c), free (p->s), free (p->hc), free (p->hs);
+  free (p->re), free (p->im);
+}
+
+static void fft (FFTPlan * p, int sign)
+{
+  int n = p->n;
+  double * re = p->re, * im = p->im;
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      swap (double, re[i], re[j]);
+      swap (double, im[i], im[j]);
+    }
+  }
+  for (int len = 2; len <= n; len <<= 1) {
+    int step = n/len;
+    for (int i = 0; i < n; i += len)
+      for (int k = 0; k < len/2; k++) {
+	double wr = p->c[k*step], wi = sign*p->s[k*step];
+	int a = i + k, b = a + len/2;
+	double tr = re[b]*wr - im[b]*wi, ti = re[b]*wi + im[b]*wr;
+	re[b] = re[a] - tr, im[b] = im[a] - ti;
+	re[a] += tr, im[a] += ti;
+      }
+  }
+}
+
+/**
+## Real transforms
+
+Each line of *n* cells is transformed into *n* real coefficients, for
+the eigenvectors of the one-dimensional discrete Laplacian, with the
+boundary conditions in this direction.
+
+For periodic conditions, the complex transform (of length $n$) of the
+real data is stored in "half-complex" format: the real parts of the
+coefficients $0 \leq k \leq n/2$ are followed by the imaginary parts
+of the coefficients $n/2 > k > 0$.
+
+For Neumann (resp. Dirichlet) conditions, the ghost values of the
+(homogeneous) boundary conditions are given by even (resp. odd)
+reflections of the interior values. The corresponding eigenvectors are
+$\cos(\pi k (i + 1/2)/n)$ for $0 \leq k < n$ (resp. $\sin(\pi k (i +
+1/2)/n)$ for $0 < k \leq n$) i.e. the transforms are the discrete
+cosine (resp. sine) transforms of type II. They are computed using the
+complex transform (of length $2n$) of the even (resp. odd) extension
+of the data. */
+
+enum { fft_periodic, fft_neumann, fft_dirichlet };
+
+static void fft_forward (FFTPlan * p, int type, double * f, int n)
+{
+  if (type == fft_periodic) {
+    for (int i = 0; i < n; i++)
+      p->re[i] = f[i], p->im[i] = 0.;
+    fft (p, -1);
+    for (int k = 0; k <= n/2; k++)
+      f[k] = p->re[k];
+    for (int k = 1; k < n - n/2; k++)
+      f[n - k] = p->im[k];
+  }
+  else {
+    double sign = type == fft_neumann ? 1. : -1.;
+    for (int i = 0; i < n; i++) {
+      p->re[i] = f[i], p->re[2*n - 1 - i] = sign*f[i];
+      p->im[i] = p->im[2*n - 1 - i] = 0.;
+    }
+    fft (p, -1);
+    for (int k = 0; k < n; k++) {
+      int m = type == fft_neumann ? k : k + 1;
+
+      /**
+      The coefficient is the real (resp. minus the imaginary) part of
+      $e^{-i\pi m/2n}Y_m/2$, with $Y$ the complex transform. */
+
+      double c = p->hc[m]/2., s = p->hs[m]/2.;
+      f[k] = type == fft_neumann ?
+	c*p->re[m] + s*p->im[m] :
+	s*p->re[m] - c*p->im[m];
+    }
+  }
+}
+
+/**
+The backward transforms are the inverses of the transforms above,
+multiplied by *n* i.e. the discrete cosine (resp. sine) transforms of
+type III, for Neumann (resp. Dirichlet) conditions. */
+
+static void fft_backward (FFTPlan * p, int type, double * f, int n)
+{
+  if (type == fft_periodic) {
+    p->re[0] = f[0], p->im[0] = 0.;
+    for (int k = 1; k < n - n/2; k++) {
+      p->re[k] = p->re[n - k] = f[k];
+      p->im[k] = f[n - k], p->im[n - k] = - f[n - k];
+    }
+    if (n > 1)
+      p->re[n/2] = f[n/2], p->im[n/2] = 0.;
+    fft (p, 1);
+    for (int i = 0; i < n; i++)
+      f[i] = p->re[i];
+  }
+  else {
+    p->re[0] = p->im[0] = p->re[n] = p->im[n] = 0.;
+    for (int k = 0; k < n; k++) {
+      int m = type == fft_neumann ? k : k + 1;
+
+      /**
+      $Y_m = e^{i\pi m/2n} c_m$ (resp. $-i e^{i\pi m/2n} c_m$) and
+      $Y_{2n - m} = \overline{Y_m}$. */
+
+      double c = p->hc[m], s = p->hs[m];
+      if (type == fft_neumann)
+	p->re[m] = c*f[k], p->im[m] = s*f[k];
+      else
+	p->re[m] = s*f[k], p->im[m] = - c*f[k];
+      if (m > 0 && m < n)
+	p->re[2*n - m] = p->re[m], p->im[2*n - m] = - p->im[m];
+    }
+    fft (p, 1);
+    for (int i = 0; i < n; i++)
+      f[i] = p->re[i];
+  }
+}
+
+/**
+The corresponding eigenvalues of the one-dimensional operator
+$\Delta^2 \partial_{xx}$, for coefficient *k*, are */
+
+static double fft_eigenvalue (int type, int k, int n)
+{
+  if (type == fft_periodic)
+    return - 4.*sq(sin (pi*(k <= n/2 ? k : n - k)/n));
+  if (type == fft_dirichlet)
+    k++;
+  return - 4.*sq(sin (pi*k/(2.*n)));
+}
+
+/**
+The multidimensional transforms are applied one direction after the
+other, to all the lines of a (contiguous) array of $n_x\times
+n_y\times n_z$ values. */
+
+static void fft_transform (double * f, const int n[3], const int type[3],
+			   bool forward)
+{
+  int stride = 1;
+  for (int d = 0; d < dimension; d++) {
+    int len = type[d] == fft_periodic ? n[d] : 2*n[d];
+    FFTPlan p = fft_plan (len);
+    double * line = qmalloc (n[d], double);
+    int nlines = n[0]*n[1]*n[2]/n[d];
+    for (int l = 0; l < nlines; l++) {
+      double * start = f + (l % stride) + (l/stride)*stride*n[d];
+      for (int i = 0; i < n[d]; i++)
+	line[i] = start[i*stride];
+      if (forward)
+	fft_forward (&p, type[d], line, n[d]);
+      else
+	fft_backward (&p, type[d], line, n[d]);
+      for (int i = 0; i < n[d]; i++)
+	start[i*stride] = line[i];
+    }
+    free (line);
+    fft_plan_free (&p);
+    stride *= n[d];
+  }
+}
+
+/**
+## Boundary conditions
+
+The type of the boundary conditions is obtained by applying the
+(homogeneous) boundary conditions of *a* to a field equal to one
+everywhere: the ghost values are then one for Neumann conditions and
+minus one for Dirichlet conditions. Any other value (or different
+values along the same boundary) means that the conditions are not
+supported. The function returns `false` in this case. */
+
+#define fft_index(x, X0) ((int)(((x) - (X0))/Delta))
+#if dimension == 1
+# define fft_cell(n) fft_index (x, X0)
+#elif dimension == 2
+# define fft_cell(n) (fft_index (x, X0) + (n)[0]*fft_index (y, Y0))
+#else // dimension == 3
+# define fft_cell(n) (fft_index (x, X0) +				\
+		      (n)[0]*(fft_index (y, Y0) + (n)[1]*fft_index (z, Z0)))
+#endif
+
+static bool fft_boundary_types (scalar a, const int n[3], int type[3])
+{
+  scalar * probe = mg_homogeneous_clone ({a}), s = probe[0];
+  foreach()
+    s[] = 1.;
+  double gmin[6] = {HUGE, HUGE, HUGE, HUGE, HUGE, HUGE};
+  double gmax[6] = {-HUGE, -HUGE, -HUGE, -HUGE, -HUGE, -HUGE};
+  foreach (reduction(min:gmin[:6]) reduction(max:gmax[:6])) {
+    int i = fft_index (x, X0);
+    if (i == 0)
+      gmin[0] = min (gmin[0], s[-1]), gmax[0] = max (gmax[0], s[-1]);
+    if (i == n[0] - 1)
+      gmin[1] = min (gmin[1], s[1]), gmax[1] = max (gmax[1], s[1]);
+#if dimension > 1
+    int j = fft_index (y, Y0);
+    if (j == 0)
+      gmin[2] = min (gmin[2], s[0,-1]), gmax[2] = max (gmax[2], s[0,-1]);
+    if (j == n[1] - 1)
+      gmin[3] = min (gmin[3], s[0,1]), gmax[3] = max (gmax[3], s[0,1]);
+#endif
+#if dimension > 2
+    int k = fft_index (z, Z0);
+    if (k == 0)
+      gmin[4] = min (gmin[4], s[0,0,-1]), gmax[4] = max (gmax[4], s[0,0,-1]);
+    if (k == n[2] - 1)
+      gmin[5] = min (gmin[5], s[0,0,1]), gmax[5] = max (gmax[5], s[0,0,1]);
+#endif
+  }
+  delete (probe), free (probe);
+
+  for (int d = 0; d < dimension; d++) {
+    if ((&Period.x)[d])
+      type[d] = fft_periodic;
+    else if (gmin[2*d] == 1. && gmax[2*d] == 1. &&
+	     gmin[2*d + 1] == 1. && gmax[2*d + 1] == 1.)
+      type[d] = fft_neumann;
+    else if (gmin[2*d] == -1. && gmax[2*d] == -1. &&
+	     gmin[2*d + 1] == -1. && gmax[2*d + 1] == -1.)
+      type[d] = fft_dirichlet;
+    else
+      return false;
+  }
+  return true;
+}
+
+/**
+## Solver
+
+The solver is a "direct" solver for
+[poisson()](poisson.h#direct-solvers). It returns `false` if the
+problem is not supported, in which case the multigrid solver is
+used.
+
+The FFT solver is applied to the residual of the equation, with
+homogeneous boundary conditions, and the resulting correction is
+added to *a*. This takes into account inhomogeneous boundary
+conditions (through the residual) and makes it possible to iterate
+(to improve the accuracy if necessary, or to satisfy *NITERMIN*). */
+
+trace
+bool poisson_fft (struct Poisson * p, mgstats * s)
+{
+#if TREE || _MPI || _GPU
+  return false;
+#else
+#if EMBED
+  if (p->embed_flux)
+    return false;
+#endif
+  scalar a = p->a, b = p->b;
+  (const) scalar lambda = p->lambda;
+  (const) face vector alpha = p->alpha;
+  if (!is_constant (lambda))
+    return false;
+  double coef[3] = {0., 0., 0.};
+  for (int d = 0; d < dimension; d++) {
+    scalar c = (&alpha.x)[d];
+    if (!is_constant (c))
+      return false;
+    coef[d] = constant (c);
+  }
+
+  /**
+  We get the number of cells in each direction, which must be powers
+  of two, and the boundary conditions. */
+
+  int n[3] = {1, 1, 1}, type[3] = {0, 0, 0};
+  int n0 = 0, n1 = 0, n2 = 0;
+  foreach (reduction(max:n0) reduction(max:n1) reduction(max:n2)) {
+    n0 = max (n0, fft_index (x, X0) + 1);
+#if dimension > 1
+    n1 = max (n1, fft_index (y, Y0) + 1);
+#endif
+#if dimension > 2
+    n2 = max (n2, fft_index (z, Z0) + 1);
+#endif
+  }
+  n[0] = n0, n[1] = max (n1, 1), n[2] = max (n2, 1);
+  for (int d = 0; d < dimension; d++)
+    if (n[d] & (n[d] - 1))
+      return false;
+  if (!fft_boundary_types (a, n, type))
+    return false;
+
+  /**
+  The initial residual is computed. */
+
+  timer t = timer_start();
+  mgstats m = {0};
+  double sum = 0.;
+  foreach (reduction(+:sum))
+    sum += b[];
+  m.sum = sum;
+  scalar res = p->res ? p->res[0] : new scalar;
+  m.resb = m.resa = residual ({a}, {b}, {res}, p);
+
+  /**
+  We iterate until convergence (which should require a single
+  iteration). */
+
+  double * f = qmalloc (n[0]*n[1]*n[2], double), ncells = n[0]*n[1]*n[2];
+  double resb = HUGE;
+  for (m.i = 0;
+       m.i < NITERMAX && (m.i < NITERMIN || m.resa > TOLERANCE) &&
+	 m.resa < resb;
+       m.i++) {
+    foreach()
+      f[fft_cell (n)] = sq(Delta)*res[];
+    fft_transform (f, n, type, true);
+
+    /**
+    In spectral space, the operator is diagonal. Singular modes (for
+    example the mean for the Poisson equation with periodic or
+    Neumann conditions) are set to zero. */
+
+    double l0 = constant (lambda)*sq(L0/n[0]);
+    double eps = 1e-12*(fabs (coef[0]) + fabs (coef[1]) + fabs (coef[2]));
+    for (int k = 0; k < n[2]; k++)
+      for (int j = 0; j < n[1]; j++)
+	for (int i = 0; i < n[0]; i++) {
+	  double e = l0 + coef[0]*fft_eigenvalue (type[0], i, n[0]);
+#if dimension > 1
+	  e += coef[1]*fft_eigenvalue (type[1], j, n[1]);
+#endif
+#if dimension > 2
+	  e += coef[2]*fft_eigenvalue (type[2], k, n[2]);
+#endif
+	  int index = i + n[0]*(j + n[1]*k);
+	  if (fabs (e) > eps)
+	    f[index] /= e*ncells;
+	  else
+	    f[index] = 0.;
+	}
+    fft_transform (f, n, type, false);
+    foreach()
+      a[] += f[fft_cell (n)];
+    resb = m.resa;
+    m.resa = residual ({a}, {b}, {res}, p);
+  }
+  free (f);
+  if (!p->res)
+    delete ({res});
+  m.t = m.tcycle = timer_elapsed (t);
+
+  /**
+  If the tolerance could not be reached, the multigrid solver takes
+  over. */
+
+  if (m.resa > TOLERANCE)
+    return false;
+  *s = m;
+  return true;
+#endif // !(TREE || _MPI || _GPU)
+}
+
+event defaults (i = 0)
+{
+  poisson_direct = poisson_fft;
+}
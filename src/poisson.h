@@ -27,14 +27,471 @@ approximate solution $\tilde{a}$.
 Here we implement the multigrid cycle proper. Given an initial guess
 *a*, a residual *res*, a correction field *da* and a relaxation
 function *relax*, we will provide an improved guess at the end of the
-cycle. */
+cycle.
+
+The residual of the finest level is restricted onto all levels. With
+the default `MG_CYCLE_SIMPLE` cycle, each level is then relaxed,
+starting from the interpolated correction of the coarser level. Coarse
+levels thus never receive the residuals of the corrected finer levels
+and each level is visited once. Note that pre-smoothing (i.e. relaxing
+the finest level before computing the residual) does not help with
+this cycle: it makes the residual harder to reduce on the coarse
+levels and slows down convergence.
+
+If the solver also provides a *level_residual* function, which
+computes the residual of the correction *da* on a given level, the
+complete levels (i.e. the levels which are not finer than the coarsest
+leaf) can instead use classical recursive cycles. On these levels,
+the residual of the (pre-smoothed) correction is restricted onto the
+coarser level, which is then corrected recursively, *γ* times,
+before the interpolated coarse correction is added and post-smoothed:
+
+* `MG_CYCLE_V`: V-cycles ($\gamma = 1$),
+* `MG_CYCLE_W`: W-cycles ($\gamma = 2$),
+* `MG_CYCLE_F`: F-cycles (an F-cycle followed by a V-cycle).
+
+The relaxations of each level are split evenly between pre- and
+post-smoothing. The finer, adaptive levels of a tree (on which coarse
+leaves are shared between levels) always use the simple cycle.
+`MG_CYCLE_AUTO` selects the cycle [automatically](#automatic-tuning).
+
+The number of relaxations can also vary with the level. The
+relaxation *schedule* sets the number of relaxations on level *l*,
+through the `mg_nrelax()` function below, to:
+
+* `MG_SCHEDULE_UNIFORM`: *nrelax* on all levels (the default),
+* `MG_SCHEDULE_GEOMETRIC`: $n_\text{relax}2^{l_\text{max} - l}$ (the
+  number of times a W-cycle would visit level *l*),
+* `MG_SCHEDULE_LINEAR`: $n_\text{relax}(l_\text{max} - l + 1)$ (the
+  number of times an F-cycle would visit level *l*).
+
+The counts are bounded by *MG_NRELAX_MAX*. Other per-level relaxation
+counts can be set by replacing the `mg_nrelax()` function. */
+
+enum { MG_CYCLE_SIMPLE, MG_CYCLE_V, MG_CYCLE_W, MG_CYCLE_F, MG_CYCLE_AUTO };
+enum { MG_SCHEDULE_UNIFORM, MG_SCHEDULE_GEOMETRIC, MG_SCHEDULE_LINEAR };
+int MG_NRELAX_MAX = 100;
+
+static int mg_nrelax_schedule (int nrelax, int schedule, int level, int maxlevel)
+{
+  int n = (schedule == MG_SCHEDULE_GEOMETRIC ? nrelax << min (maxlevel - level, 16) :
+	   schedule == MG_SCHEDULE_LINEAR ? nrelax*(maxlevel - level + 1) :
+	   nrelax);
+  return max (nrelax, min (n, MG_NRELAX_MAX));
+}
+
+int (* mg_nrelax) (int nrelax, int schedule, int level, int maxlevel) =
+  mg_nrelax_schedule;
+
+/**
+## Coarse-level direct solver
+
+With MPI, all the processes take part in the relaxation of every
+level. The coarsest levels contain very few cells, but each relaxation
+still requires an exchange of ghost values between processes, which is
+dominated by latency. Rather than relaxing these levels, they can be
+*agglomerated* into a single coarse level, of at most `MG_COARSE`
+cells (the default, zero, turns this off). The residual on this level
+is gathered on all processes (using a single collective reduction) and
+each process then solves the same (small) system directly, using a
+banded LU factorisation. The levels below the coarse level are not
+used at all. The factorisation is [kept](#caching-the-operator) for the
+next solutions, as long as the operator does not change.
+
+The `MGCoarse` structure stores the operator of the coarse level and
+its factorisation. The operator must be provided by the solver of a
+specific equation (see [below](#coarse-level-operator)). */
+
+int MG_COARSE = 0;
+
+typedef struct {
+  int level;     // the level of the coarse grid
+  int n[3], len; // the number of cells in each direction and in total
+  int * col;     // the columns (plus one) of the coupling coefficients
+  double * val;  // the coupling coefficients
+  int band;      // the half-bandwidth of the operator
+  double * lu;   // the banded LU factorisation
+  double * r;    // the right-hand-side and solution
+  int a;         // the unknown (for cached operators)
+  uint64_t hash; // the hash of the local coefficients
+} MGCoarse;
+
+/**
+Each row of the operator has a diagonal coefficient and (at most) $2d$
+off-diagonal coefficients. The cells of the coarse level are numbered
+using their global (integer) coordinates. In periodic directions, the
+coordinates are "folded" (i.e. 0, 2, 4, ..., 5, 3, 1) so that the
+neighbours across the periodic boundary are also close: the bandwidth
+of the operator is then at most twice that of the non-periodic
+operator, rather than of the order of the number of cells. */
+
+#define MG_COARSE_ROW (2*dimension + 1)
+
+static inline int mg_coarse_fold (double x, int n, bool periodic)
+{
+  int i = x;
+  return !periodic ? i : i < (n + 1)/2 ? 2*i : 2*(n - 1 - i) + 1;
+}
+
+#if dimension == 1
+# define mg_coarse_index(c)					\
+  mg_coarse_fold ((x - X0)/Delta, (c)->n[0], Period.x)
+#elif dimension == 2
+# define mg_coarse_index(c)						\
+  (mg_coarse_fold ((x - X0)/Delta, (c)->n[0], Period.x) +		\
+   (c)->n[0]*mg_coarse_fold ((y - Y0)/Delta, (c)->n[1], Period.y))
+#else // dimension == 3
+# define mg_coarse_index(c)						\
+  (mg_coarse_fold ((x - X0)/Delta, (c)->n[0], Period.x) +		\
+   (c)->n[0]*(mg_coarse_fold ((y - Y0)/Delta, (c)->n[1], Period.y) +	\
+	      (c)->n[1]*mg_coarse_fold ((z - Z0)/Delta, (c)->n[2], Period.z)))
+#endif
+
+/**
+The `mg_coarse_new()` function returns a new (empty) operator for the
+finest complete level with at most `MG_COARSE` cells, or NULL if this
+level is coarser than *minlevel*. The cells of each level are counted
+locally and summed using a single reduction. */
+
+MGCoarse * mg_coarse_new (int minlevel, int maxlevel)
+{
+  long nl[maxlevel + 1];
+  bool full = false;
+  for (int l = 0; l <= maxlevel; l++) {
+    nl[l] = 0;
+    if (full)
+      nl[l] = MG_COARSE + 1;
+    else {
+      foreach_level (l, serial)
+	nl[l]++;
+      full = nl[l] > MG_COARSE;
+    }
+  }
+  mpi_all_reduce_array (nl, MPI_LONG, MPI_SUM, maxlevel + 1);
+  int level = -1;
+  for (int l = 0; l <= maxlevel; l++) {
+    if (nl[l] > MG_COARSE || (l > 0 && nl[l] != nl[l - 1] << dimension))
+      break;
+    level = l;
+  }
+  if (level < minlevel)
+    return NULL;
+  long n = nl[level];
+
+  MGCoarse * c = qcalloc (1, MGCoarse);
+  c->level = level;
+  int n0 = 0, n1 = 0, n2 = 0;
+  foreach_level (level, reduction(max:n0) reduction(max:n1) reduction(max:n2)) {
+    n0 = max (n0, (int)((x - X0)/Delta) + 1);
+#if dimension > 1
+    n1 = max (n1, (int)((y - Y0)/Delta) + 1);
+#endif
+#if dimension > 2
+    n2 = max (n2, (int)((z - Z0)/Delta) + 1);
+#endif
+  }
+  c->n[0] = n0, c->n[1] = max (n1, 1), c->n[2] = max (n2, 1);
+  c->len = c->n[0]*c->n[1]*c->n[2];
+  assert (c->len == n);
+  c->col = qcalloc (c->len*MG_COARSE_ROW, int);
+  c->val = qcalloc (c->len*MG_COARSE_ROW, double);
+  c->r = qmalloc (c->len, double);
+  return c;
+}
+
+void mg_coarse_free (MGCoarse * c)
+{
+  if (c) {
+    free (c->col), free (c->val), free (c->lu), free (c->r);
+    free (c);
+  }
+}
+
+/**
+The coupling coefficients with the neighbours of a cell are found
+using a "probe" field *s*, which must have the (homogeneous) boundary
+conditions of the unknown. It is set to the (global) index of each
+cell plus one on the coarse level. The ghost value *g* of a neighbour
+is then either the index of the neighbour plus one (for a neighbouring
+cell or a periodic boundary), or a multiple of the value *v* of the
+cell itself (for homogeneous Neumann or Dirichlet conditions). */
+
+void mg_coarse_probe (MGCoarse * c, scalar s)
+{
+  foreach_level (c->level)
+    s[] = mg_coarse_index (c) + 1;
+  boundary_level ({s}, c->level);
+}
+
+void mg_coarse_couple (MGCoarse * c, int row, int k, double g, double v,
+		       double coef)
+{
+  if (g != v && g >= 1. && fabs (g - nearbyint (g)) < 1e-6) {
+    c->col[row*MG_COARSE_ROW + k] = nearbyint (g);
+    c->val[row*MG_COARSE_ROW + k] = coef;
+  }
+  else
+    c->val[row*MG_COARSE_ROW] += coef*g/v;
+}
+
+/**
+Once the coefficients of the local cells have been set (using
+`mg_coarse_couple()` for the off-diagonal coefficients), the operator
+is gathered on all processes and factorised. The factorisation does
+not use pivoting, which is fine for the (diagonally-dominant)
+operators of Poisson--Helmholtz equations. Singular operators (for
+example Poisson equations with Neumann conditions on all boundaries)
+give a vanishing pivot, for which the corresponding unknown is set to
+zero. */
+
+#define mg_lu(c,i,j) (c)->lu[(i)*(2*(c)->band + 1) + (j) - (i) + (c)->band]
+
+void mg_coarse_factor (MGCoarse * c)
+{
+  mpi_all_reduce_array (c->col, MPI_INT, MPI_SUM, c->len*MG_COARSE_ROW);
+  mpi_all_reduce_array (c->val, MPI_DOUBLE, MPI_SUM, c->len*MG_COARSE_ROW);
+  c->band = 0;
+  for (int i = 0; i < c->len; i++)
+    for (int k = 1; k < MG_COARSE_ROW; k++)
+      if (c->col[i*MG_COARSE_ROW + k])
+	c->band = max (c->band, abs (c->col[i*MG_COARSE_ROW + k] - 1 - i));
+  free (c->lu);
+  c->lu = qcalloc (c->len*(2*c->band + 1), double);
+  for (int i = 0; i < c->len; i++) {
+    mg_lu (c, i, i) += c->val[i*MG_COARSE_ROW];
+    for (int k = 1; k < MG_COARSE_ROW; k++)
+      if (c->col[i*MG_COARSE_ROW + k])
+	mg_lu (c, i, c->col[i*MG_COARSE_ROW + k] - 1) +=
+	  c->val[i*MG_COARSE_ROW + k];
+  }
+  for (int k = 0; k < c->len; k++) {
+    double p = mg_lu (c, k, k);
+    int last = min (c->len - 1, k + c->band);
+    if (fabs (p) <= 1e-10*fabs (c->val[k*MG_COARSE_ROW])) {
+      for (int i = k; i <= last; i++)
+	mg_lu (c, i, k) = 0.;
+      continue;
+    }
+    for (int i = k + 1; i <= last; i++)
+      if (mg_lu (c, i, k)) {
+	double l = (mg_lu (c, i, k) /= p);
+	for (int j = k + 1; j <= last; j++)
+	  mg_lu (c, i, j) -= l*mg_lu (c, k, j);
+      }
+  }
+}
+
+/**
+The correction *da* on the coarse level is the solution of the system
+for the residual *res*. */
+
+trace
+void mg_coarse_solve (MGCoarse * c, scalar da, scalar res)
+{
+  memset (c->r, 0, c->len*sizeof(double));
+  foreach_level (c->level, nowarning)
+    c->r[mg_coarse_index (c)] = res[];
+  mpi_all_reduce_array (c->r, MPI_DOUBLE, MPI_SUM, c->len);
+  for (int i = 0; i < c->len; i++)
+    for (int k = max (0, i - c->band); k < i; k++)
+      c->r[i] -= mg_lu (c, i, k)*c->r[k];
+  for (int i = c->len - 1; i >= 0; i--)
+    if (mg_lu (c, i, i)) {
+      for (int j = i + 1; j <= min (c->len - 1, i + c->band); j++)
+	c->r[i] -= mg_lu (c, i, j)*c->r[j];
+      c->r[i] /= mg_lu (c, i, i);
+    }
+    else
+      c->r[i] = 0.;
+  foreach_level (c->level, nowarning)
+    da[] = c->r[mg_coarse_index (c)];
+}
+
+/**
+### Caching the operator
+
+Assembling, gathering and factorising the operator costs much more
+than solving the coarse problem, so the operators are kept from one
+solution to the next, for each unknown. The solver of a specific
+equation computes a *hash* of the coefficients of the local cells of
+the coarse level (and of anything else the operator depends on) and
+counts these cells. A cached operator is reused only if its hash is
+unchanged on all processes and if its coarse level is still complete,
+which is checked using a single reduction. */
+
+static inline uint64_t mg_hash (uint64_t h, const void * p, size_t size)
+{
+  const unsigned char * b = p;
+  while (size--)
+    h = (h ^ *b++)*1099511628211ULL;
+  return h;
+}
+
+#define MG_HASH_SEED 14695981039346656037ULL
+#define mg_hash_value(h, v) do { double _v = v; \
+    h = mg_hash (h, &_v, sizeof (double)); } while (0)
+
+static Array * mg_coarse_cache = NULL;
+
+static void mg_coarse_cache_free()
+{
+  MGCoarse ** c = mg_coarse_cache->p;
+  for (int i = 0; i < mg_coarse_cache->len/sizeof(MGCoarse *); i++)
+    mg_coarse_free (c[i]);
+  array_free (mg_coarse_cache);
+  mg_coarse_cache = NULL;
+}
+
+/**
+The function below returns the cached operator for unknown *a*, if
+it is valid. Otherwise the operator (if any) is freed and NULL is
+returned. The *hash* function is called with the level of the cached
+operator. */
+
+MGCoarse * mg_coarse_cached (scalar a, uint64_t (* hash) (int level, long * n,
+							   void * data),
+			     void * data)
+{
+  if (!mg_coarse_cache)
+    return NULL;
+  MGCoarse ** c = mg_coarse_cache->p;
+  int n = mg_coarse_cache->len/sizeof(MGCoarse *);
+  for (int i = 0; i < n; i++)
+    if (c[i]->a == a.i) {
+      long v[2] = {0, 0};
+      v[0] = hash (c[i]->level, &v[1], data) != c[i]->hash;
+      mpi_all_reduce_array (v, MPI_LONG, MPI_SUM, 2);
+      if (!v[0] && v[1] == c[i]->len)
+	return c[i];
+      mg_coarse_free (c[i]);
+      c[i] = c[n - 1];
+      mg_coarse_cache->len -= sizeof(MGCoarse *);
+      return NULL;
+    }
+  return NULL;
+}
+
+/**
+This stores (new) operator *c* for unknown *a*. */
+
+void mg_coarse_store (MGCoarse * c, scalar a, uint64_t hash)
+{
+  if (!mg_coarse_cache) {
+    mg_coarse_cache = array_new();
+    free_solver_func_add (mg_coarse_cache_free);
+  }
+  c->a = a.i, c->hash = hash;
+  array_append (mg_coarse_cache, &c, sizeof(MGCoarse *));
+}
+
+/**
+## Recursive cycles
+
+The function below returns the finest complete level, i.e. the level
+of the coarsest leaf (over all processes). */
+
+static int mg_complete_level (int maxlevel)
+{
+  int lc = maxlevel;
+#if TREE
+  foreach (reduction(min:lc))
+    if (level < lc)
+      lc = level;
+#endif
+  return lc;
+}
+
+/**
+This is the recursive cycle on the complete level *l*. The residual
+of level *l - 1* is stored in *res* and the residual of level *l* is
+computed in the temporary fields *r*. */
+
+static void mg_cycle_level (scalar * res, scalar * da, scalar * r,
+			    void (* relax) (scalar * da, scalar * res,
+					    int depth, void * data),
+			    void (* level_residual) (scalar * da, scalar * res,
+						     scalar * r, int depth,
+						     void * data),
+			    void * data, int nrelax, int schedule, int cycle,
+			    int l, int minlevel, int maxlevel,
+			    MGCoarse * coarse)
+{
+  int n = mg_nrelax (nrelax, schedule, l, maxlevel);
+  
+  /**
+  On the coarsest level, the correction is the solution of the direct
+  solver or is relaxed. */
+
+  if (l == minlevel) {
+    if (coarse)
+      mg_coarse_solve (coarse, da[0], res[0]);
+    else
+      for (int i = 0; i < n; i++) {
+	boundary_level (da, l);
+	relax (da, res, l, data);
+      }
+    return;
+  }
+
+  /**
+  Pre-smoothing. */
+  
+  for (int i = 0; i < n/2; i++) {
+    boundary_level (da, l);
+    relax (da, res, l, data);
+  }
+
+  /**
+  The residual is restricted onto the coarser level, for which zero is
+  the initial guess of the correction. */
+  
+  boundary_level (da, l);
+  level_residual (da, res, r, l, data);
+  boundary_level (r, l);
+  foreach_coarse_level (l - 1, nowarning) {
+    scalar s, t, ds;
+    for (s, t, ds in r, res, da) {
+      s.restriction (point, s);
+      foreach_blockf (t)
+	t[] = s[], ds[] = 0.;
+    }
+  }
+
+  /**
+  The coarser level is corrected recursively and its correction is
+  interpolated and added to the current level. */
+  
+  for (int i = 0; i < (cycle == MG_CYCLE_V ? 1 : 2); i++)
+    mg_cycle_level (res, da, r, relax, level_residual, data, nrelax, schedule,
+		    cycle == MG_CYCLE_F && i ? MG_CYCLE_V : cycle,
+		    l - 1, minlevel, maxlevel, coarse);
+  boundary_level (da, l - 1);
+  foreach_level (l)
+    for (scalar s in da)
+      foreach_blockf (s)
+	s[] += bilinear (point, s);
+
+  /**
+  Post-smoothing. */
+  
+  for (int i = n/2; i < n; i++) {
+    boundary_level (da, l);
+    relax (da, res, l, data);
+  }
+}
 
 trace
 void mg_cycle (scalar * a, scalar * res, scalar * da,
 	       void (* relax) (scalar * da, scalar * res, 
 			       int depth, void * data),
 	       void * data,
-	       int nrelax, int minlevel, int maxlevel)
+	       int nrelax, int minlevel, int maxlevel,
+	       int schedule = MG_SCHEDULE_UNIFORM,
+	       MGCoarse * coarse = NULL,
+	       int cycle = MG_CYCLE_SIMPLE,
+	       void (* level_residual) (scalar * da, scalar * res,
+					scalar * r, int depth,
+					void * data) = NULL)
 {
 
   /**
@@ -43,12 +500,47 @@ void mg_cycle (scalar * a, scalar * res, scalar * da,
   restriction (res);
 
   /**
-  We then proceed from the coarsest grid (*minlevel*) down to the
-  finest grid. */
+  We then proceed from the coarsest grid (*minlevel*, or the level of
+  the [coarse solver](#coarse-level-direct-solver) if it is set) down to
+  the finest grid. */
 
   minlevel = min (minlevel, maxlevel);
-  for (int l = minlevel; l <= maxlevel; l++) {
+  if (coarse && coarse->level >= minlevel && coarse->level <= maxlevel)
+    minlevel = coarse->level;
+  else
+    coarse = NULL;
+  int l = minlevel;
+
+  /**
+  With recursive cycles, the complete levels are corrected first,
+  starting from a zero correction on the finest complete level. */
+  
+  if (cycle != MG_CYCLE_SIMPLE && level_residual) {
+    int lc = mg_complete_level (maxlevel);
+    if (lc > minlevel) {
+      foreach_level (lc)
+	for (scalar s in da)
+	  foreach_blockf (s)
+	    s[] = 0.;
+      scalar * r = list_clone (res);
+      mg_cycle_level (res, da, r, relax, level_residual, data, nrelax,
+		      schedule, cycle, lc, minlevel, maxlevel, coarse);
+      delete (r), free (r);
+      l = lc + 1;
+    }
+  }
+  
+  for (; l <= maxlevel; l++) {
 
+    /**
+    On the coarse level, the correction is the solution of the direct
+    solver. */
+
+    if (coarse && l == minlevel) {
+      mg_coarse_solve (coarse, da[0], res[0]);
+      continue;
+    }
+    
     /**
     On the coarsest grid, we take zero as initial guess. */
 
@@ -74,7 +566,7 @@ void mg_cycle (scalar * a, scalar * res, scalar * da,
     We then apply homogeneous boundary conditions and do several
     iterations of the relaxation function to refine the initial guess. */
 
-    for (int i = 0; i < nrelax; i++) {
+    for (int i = 0, n = mg_nrelax (nrelax, schedule, l, maxlevel); i < n; i++) {
       boundary_level (da, l);
       relax (da, res, l, data);
     }
@@ -113,16 +605,318 @@ typedef struct {
   double sum;         // sum of r.h.s.
   int nrelax;         // number of relaxations
   int minlevel;       // minimum level of the multigrid hierarchy
+  double tcycle, t;   // time spent in multigrid cycles and total time
+  int schedule;       // relaxation schedule of the multigrid cycles
+  int cycle;          // shape of the multigrid cycles
 } mgstats;
 
 /**
+## Krylov solvers
+
+For stiff problems (for example large variations of the coefficients
+of the Poisson equation), the convergence of the multigrid cycles can
+be slow. A more robust solver is obtained by using a single multigrid
+cycle as the preconditioner of a Krylov method. This is controlled by
+*KRYLOV* (or the optional *krylov* argument of the solvers) which can
+be set to:
+
+* `KRYLOV_NONE`: multigrid cycles only (the default),
+* `KRYLOV_CG`: (flexible) preconditioned conjugate gradient, for
+  symmetric operators,
+* `KRYLOV_BICGSTAB`: preconditioned BiCGStab, for non-symmetric
+  operators (for example with embedded boundaries). */
+
+enum { KRYLOV_NONE, KRYLOV_CG, KRYLOV_BICGSTAB };
+int KRYLOV = KRYLOV_NONE;
+
+/**
+The Krylov vectors (and the multigrid corrections) verify the
+*homogeneous* equivalent of the boundary conditions applied to the
+unknowns. */
+
+static scalar * mg_homogeneous_clone (scalar * a)
+{
+  scalar * l = list_clone (a);
+  for (int b = 0; b < nboundary; b++)
+    for (scalar s in l)
+      s.boundary[b] = s.boundary_homogeneous[b];
+  return l;
+}
+
+/**
+The scalar product is weighted by the volume of the cells, so that
+discretely conservative operators are symmetric on adaptive meshes. */
+
+static double mg_dot (scalar * a, scalar * b)
+{
+  double sum = 0.;
+  foreach (reduction(+:sum)) {
+    scalar s, t;
+    for (s, t in a, b)
+      foreach_blockf (s)
+	sum += dv()*s[]*t[];
+  }
+  return sum;
+}
+
+/**
+This computes $a \leftarrow a + \alpha b$ and returns the maximum of
+$|a|$. */
+
+static double mg_axpy (scalar * a, double alpha, scalar * b)
+{
+  double max = 0.;
+  foreach (reduction(max:max)) {
+    scalar s, t;
+    for (s, t in a, b)
+      foreach_blockf (s) {
+	s[] += alpha*t[];
+	if (fabs (s[]) > max)
+	  max = fabs (s[]);
+      }
+  }
+  return max;
+}
+
+/**
+The preconditioner $w = M^{-1}r$ is a single multigrid cycle, starting
+from a zero initial guess. */
+
+static void mg_precondition (scalar * w, scalar * r, scalar * dz,
+			     void (* relax) (scalar * da, scalar * res,
+					     int depth, void * data),
+			     void (* level_residual) (scalar * da,
+						      scalar * res,
+						      scalar * r, int depth,
+						      void * data),
+			     void * data, int minlevel, MGCoarse * coarse,
+			     mgstats * mgs)
+{
+  timer t = timer_start();
+  foreach()
+    for (scalar s in w)
+      foreach_blockf (s)
+	s[] = 0.;
+  mg_cycle (w, r, dz, relax, data, mgs->nrelax, minlevel, grid->maxdepth,
+	    mgs->schedule, coarse, mgs->cycle, level_residual);
+  mgs->tcycle += timer_elapsed (t);
+}
+
+/**
+The operator is obtained from the residual function as $A(p) =
+-\text{residual}(p, 0)$. Given the initial residual *r*, the function
+below updates the solution *a* until the maximum residual is smaller
+than *tolerance*. */
+
+static void mg_krylov (scalar * a, scalar * b, scalar * r, scalar * da,
+		       double (* residual) (scalar * a, scalar * b,
+					    scalar * res, void * data),
+		       void (* relax) (scalar * da, scalar * res, int depth, 
+				       void * data),
+		       void (* level_residual) (scalar * da, scalar * res,
+						scalar * r, int depth,
+						void * data),
+		       void * data, int minlevel, MGCoarse * coarse,
+		       double tolerance, int krylov, mgstats * s)
+{
+  scalar * zero = list_clone (b), * p = mg_homogeneous_clone (a);
+  scalar * q = list_clone (b), * w = mg_homogeneous_clone (a);
+  foreach()
+    for (scalar s in zero)
+      foreach_blockf (s)
+	s[] = 0.;
+
+  if (krylov == KRYLOV_CG) {
+
+    /**
+    For the conjugate gradient, the preconditioner is not exactly
+    symmetric (the simple cycle only applies post-smoothing) and
+    changes with the number of relaxations, so we use the "flexible"
+    (Polak--Ribière) formula for $\beta$. */
+
+    mg_precondition (w, r, da, relax, level_residual, data, minlevel,
+		     coarse, s);
+    foreach() {
+      scalar u, v;
+      for (u, v in p, w)
+	foreach_blockf (u)
+	  u[] = v[];
+    }
+    double rz = mg_dot (r, w);
+    for (s->i = 0;
+	 s->i < NITERMAX && (s->i < NITERMIN || s->resa > tolerance);
+	 s->i++) {
+      residual (p, zero, q, data); // q = -A(p)
+      double pq = mg_dot (p, q);
+      if (!pq)
+	break;
+      double alpha = - rz/pq;
+      mg_axpy (a, alpha, p);
+      s->resa = mg_axpy (r, alpha, q);
+      if (s->resa <= tolerance && s->i + 1 >= NITERMIN) {
+	s->i++;
+	break;
+      }
+      double rzold = mg_dot (r, w);
+      mg_precondition (w, r, da, relax, level_residual, data, minlevel,
+		       coarse, s);
+      double rznew = mg_dot (r, w), beta = (rznew - rzold)/rz;
+      rz = rznew;
+      foreach() {
+	scalar u, v;
+	for (u, v in p, w)
+	  foreach_blockf (u)
+	    u[] = v[] + beta*u[];
+      }
+    }
+  }
+  else { // KRYLOV_BICGSTAB
+
+    /**
+    For BiCGStab, we use right preconditioning, so that the residual
+    *r* is that of the original system. */
+
+    scalar * r0 = list_clone (b), * v = list_clone (b), * t = list_clone (b);
+    foreach() {
+      scalar s0, s1, s2, s3;
+      for (s0, s1, s2, s3 in r0, r, p, v)
+	foreach_blockf (s0)
+	  s0[] = s1[], s2[] = s3[] = 0.;
+    }
+    double rho = 1., alpha = 1., omega = 1.;
+    for (s->i = 0;
+	 s->i < NITERMAX && (s->i < NITERMIN || s->resa > tolerance);
+	 s->i++) {
+      double rhonew = mg_dot (r0, r);
+      if (!rhonew || !omega)
+	break;
+      double beta = (rhonew/rho)*(alpha/omega);
+      rho = rhonew;
+      foreach() {
+	scalar s0, s1, s2;
+	for (s0, s1, s2 in p, r, v)
+	  foreach_blockf (s0)
+	    s0[] = s1[] + beta*(s0[] - omega*s2[]);
+      }
+      mg_precondition (w, p, da, relax, level_residual, data, minlevel,
+		       coarse, s);
+      residual (w, zero, v, data);
+      mg_axpy (v, -2., v); // v = A(w)
+      double r0v = mg_dot (r0, v);
+      if (!r0v)
+	break;
+      alpha = rho/r0v;
+      mg_axpy (a, alpha, w);
+      s->resa = mg_axpy (r, - alpha, v);
+      if (s->resa <= tolerance && s->i + 1 >= NITERMIN) {
+	s->i++;
+	break;
+      }
+      mg_precondition (w, r, da, relax, level_residual, data, minlevel,
+		       coarse, s);
+      residual (w, zero, t, data);
+      mg_axpy (t, -2., t); // t = A(w)
+      double tt = mg_dot (t, t);
+      omega = tt ? mg_dot (t, r)/tt : 0.;
+      mg_axpy (a, omega, w);
+      s->resa = mg_axpy (r, - omega, t);
+    }
+    delete (t), free (t);
+    delete (v), free (v);
+    delete (r0), free (r0);
+  }
+
+  /**
+  The final residual is recomputed to avoid the accumulation of
+  round-off errors. */
+
+  s->resa = residual (a, b, r, data);
+  
+  delete (w), free (w);
+  delete (q), free (q);
+  delete (p), free (p);
+  delete (zero), free (zero);
+}
+
+/**
+## Automatic tuning
+
+With the `MG_CYCLE_AUTO` cycle, the simple, V, W and F cycles are used
+in turn for the first `MG_TUNE` solutions (for each cycle) of a given
+problem. The cycle with the smallest total solution time is then used
+for all the subsequent solutions. Problems are identified by
+their (first) unknown and their relaxation function, so that for
+example the pressure and viscous solvers of a Navier--Stokes
+simulation are tuned independently over the first timesteps. */
+
+int MG_TUNE = 2;
+
+typedef struct {
+  int a, n, cycle; // unknown, number of solutions and selected cycle
+  void (* relax) (scalar * da, scalar * res, int depth, void * data);
+  double t[MG_CYCLE_AUTO]; // total solution time for each cycle
+} MGTuner;
+
+static Array * mg_tuners = NULL;
+
+static void mg_tuners_free()
+{
+  array_free (mg_tuners);
+  mg_tuners = NULL;
+}
+
+static MGTuner * mg_tuner (scalar a,
+			   void (* relax) (scalar * da, scalar * res,
+					   int depth, void * data))
+{
+  if (!mg_tuners) {
+    mg_tuners = array_new();
+    free_solver_func_add (mg_tuners_free);
+  }
+  int n = mg_tuners->len/sizeof(MGTuner);
+  MGTuner * t = mg_tuners->p;
+  for (int i = 0; i < n; i++, t++)
+    if (t->a == a.i && t->relax == relax)
+      return t;
+  MGTuner tuner = { .a = a.i, .cycle = -1, .relax = relax };
+  array_append (mg_tuners, &tuner, sizeof(MGTuner));
+  return ((MGTuner *) mg_tuners->p) + n;
+}
+
+/**
+This updates the timings of the tuner and selects the fastest cycle
+once all cycles have been tried. The timings are the maximum over all
+processes so that all processes select the same cycle. */
+
+static void mg_tuner_update (MGTuner * tuner, mgstats s)
+{
+  tuner->t[s.cycle] += s.t;
+  if (++tuner->n == MG_TUNE*MG_CYCLE_AUTO) {
+    mpi_all_reduce_array (tuner->t, MPI_DOUBLE, MPI_MAX, MG_CYCLE_AUTO);
+    tuner->cycle = MG_CYCLE_SIMPLE;
+    for (int c = MG_CYCLE_SIMPLE + 1; c < MG_CYCLE_AUTO; c++)
+      if (tuner->t[c] < tuner->t[tuner->cycle])
+	tuner->cycle = c;
+  }
+}
+
+/**
+## Multigrid solver interface
+
 The user needs to provide a function which computes the residual field
 (and returns its maximum) as well as the relaxation function. The
 user-defined pointer *data* can be used to pass arguments to these
 functions. The optional number of relaxations is *nrelax* and *res* is
 an optional list of fields used to store the residuals. The minimum
 level of the hierarchy can be set (default is zero i.e. the root
-cell). */
+cell). The optional *krylov* argument selects the [Krylov
+solver](#krylov-solvers), *schedule* the [relaxation
+schedule](#multigrid-cycle), *coarse* the [coarse-level
+operator](#coarse-level-direct-solver) and *cycle* the
+[cycle](#multigrid-cycle). Recursive cycles also require the
+*level_residual* function, without which the simple cycle is used. */
+
+int MG_SCHEDULE = MG_SCHEDULE_UNIFORM, MG_CYCLE = MG_CYCLE_SIMPLE;
 
 trace
 mgstats mg_solve (scalar * a, scalar * b,
@@ -134,25 +928,24 @@ mgstats mg_solve (scalar * a, scalar * b,
 		  int nrelax = 4,
 		  scalar * res = NULL,
 		  int minlevel = 0,
-		  double tolerance = TOLERANCE)
+		  double tolerance = TOLERANCE,
+		  int krylov = KRYLOV,
+		  int schedule = MG_SCHEDULE,
+		  MGCoarse * coarse = NULL,
+		  int cycle = MG_CYCLE,
+		  void (* level_residual) (scalar * da, scalar * res,
+					   scalar * r, int depth,
+					   void * data) = NULL)
 {
+  timer t = timer_start();
 
   /**
   We allocate a new correction and residual field for each of the scalars
   in *a*. */
 
-  scalar * da = list_clone (a), * pres = res;
+  scalar * da = mg_homogeneous_clone (a), * pres = res;
   if (!res)
     res = list_clone (b);
-
-  /**
-  The boundary conditions for the correction fields are the
-  *homogeneous* equivalent of the boundary conditions applied to
-  *a*. */
-
-  for (int b = 0; b < nboundary; b++)
-    for (scalar s in da)
-      s.boundary[b] = s.boundary_homogeneous[b];
   
   /**
   We initialise the structure storing convergence statistics. */
@@ -164,6 +957,16 @@ mgstats mg_solve (scalar * a, scalar * b,
     sum += rhs[];
   s.sum = sum;
   s.nrelax = nrelax > 0 ? nrelax : 4;
+  s.schedule = schedule;
+  MGTuner * tuner = NULL;
+  if (!level_residual)
+    s.cycle = MG_CYCLE_SIMPLE;
+  else if (cycle == MG_CYCLE_AUTO) {
+    tuner = mg_tuner (a[0], relax);
+    s.cycle = tuner->cycle >= 0 ? tuner->cycle : tuner->n % MG_CYCLE_AUTO;
+  }
+  else
+    s.cycle = cycle;
   
   /**
   Here we compute the initial residual field and its maximum. */
@@ -174,40 +977,54 @@ mgstats mg_solve (scalar * a, scalar * b,
   /**
   We then iterate until convergence or until *NITERMAX* is reached. Note
   also that we force the solver to apply at least one cycle, even if the
-  initial residual is lower than *TOLERANCE*. */
-  
-  for (s.i = 0;
-       s.i < NITERMAX && (s.i < NITERMIN || s.resa > tolerance);
-       s.i++) {
-    mg_cycle (a, res, da, relax, data,
-	      s.nrelax,
-	      minlevel,
-	      grid->maxdepth);
-    s.resa = (* residual) (a, b, res, data);
+  initial residual is lower than *TOLERANCE*. If *krylov* is set, the
+  iterations are those of the [Krylov solver](#krylov-solvers). */
 
-    /**
-    We tune the number of relaxations so that the residual is reduced
-    by between 2 and 20 for each cycle. This is particularly useful
-    for stiff systems which may require a larger number of relaxations
-    on the finest grid. */
+  if (krylov)
+    mg_krylov (a, b, res, da, residual, relax, level_residual, data,
+	       minlevel, coarse, tolerance, krylov, &s);
+  else
+    for (s.i = 0;
+	 s.i < NITERMAX && (s.i < NITERMIN || s.resa > tolerance);
+	 s.i++) {
+      timer tc = timer_start();
+      mg_cycle (a, res, da, relax, data,
+		s.nrelax,
+		minlevel,
+		grid->maxdepth,
+		s.schedule,
+		coarse,
+		s.cycle,
+		level_residual);
+      s.tcycle += timer_elapsed (tc);
+      s.resa = (* residual) (a, b, res, data);
+
+      /**
+      We tune the number of relaxations so that the residual is reduced
+      by between 2 and 20 for each cycle. This is particularly useful
+      for stiff systems which may require a larger number of relaxations
+      on the finest grid. */
 
 #if 1
-    if (s.resa > tolerance) {
-      if (resb/s.resa < 1.2 && s.nrelax < 100)
-	s.nrelax++;
-      else if (resb/s.resa > 10 && s.nrelax > 2)
-	s.nrelax--;
-    }
+      if (s.resa > tolerance) {
+	if (resb/s.resa < 1.2 && s.nrelax < 100)
+	  s.nrelax++;
+	else if (resb/s.resa > 10 && s.nrelax > 2)
+	  s.nrelax--;
+      }
 #else
-    if (s.resa == resb) /* convergence has stopped!! */
-      break;
-    if (s.resa > resb/1.1 && p.minlevel < grid->maxdepth)
-      p.minlevel++;
+      if (s.resa == resb) /* convergence has stopped!! */
+	break;
+      if (s.resa > resb/1.1 && p.minlevel < grid->maxdepth)
+	p.minlevel++;
 #endif
 
-    resb = s.resa;
-  }
+      resb = s.resa;
+    }
   s.minlevel = minlevel;
+  s.t = timer_elapsed (t);
+  if (tuner && tuner->cycle < 0)
+    mg_tuner_update (tuner, s);
   
   /**
   If we have not satisfied the tolerance, we warn the user. */
@@ -230,6 +1047,37 @@ mgstats mg_solve (scalar * a, scalar * b,
   return s;
 }
 
+/**
+## Multicolour relaxation
+
+The relaxation functions below update their unknowns "in place". The
+result thus depends on the order in which cells are traversed, which
+is not deterministic with OpenMP (or on GPUs). Multicolour
+Gauss--Seidel relaxation avoids this by splitting the cells into
+independent sets ("colours") which are relaxed one after the
+other. With two colours ("red/black") neighbouring cells, sharing a
+face, always have different colours. With $2^d$ colours (4 in 2D, 8 in
+3D), all the cells of the $3^d$ stencil have different colours. The
+`mg_colour()` macro returns the colour of the current cell.
+
+Multicolour relaxation is used on GPUs, with OpenMP (unless `JACOBI`
+is set) and whenever `GAUSS_SEIDEL` is set. It can be turned off with
+`-DMULTICOLOUR=0`. */
+
+#ifndef MULTICOLOUR
+# define MULTICOLOUR (GAUSS_SEIDEL || _GPU || (_OPENMP && !JACOBI))
+#endif
+
+#if dimension == 1
+# define mg_colour(n) (point.i % 2)
+#elif dimension == 2
+# define mg_colour(n) ((n) == 2 ? (point.i + point.j) % 2 :	\
+		       point.i % 2 + 2*(point.j % 2))
+#else // dimension == 3
+# define mg_colour(n) ((n) == 2 ? (point.i + point.j + point.k) % 2 :	\
+		       point.i % 2 + 2*(point.j % 2) + 4*(point.k % 2))
+#endif
+
 /**
 ## Application to the Poisson--Helmholtz equation
 
@@ -249,7 +1097,10 @@ default *TOLERANCE* of the multigrid solver, *nrelax* controls the
 initial number of relaxations (default is one), *minlevel* controls
 the minimum level of the hierarchy (default is one) and *res* is an
 optional list of fields used to store the final residual (which can be
-useful to monitor convergence). */
+useful to monitor convergence). *krylov* selects the [Krylov
+solver](#krylov-solvers), *schedule* the [relaxation
+schedule](#multigrid-cycle) and *cycle* the [shape](#multigrid-cycle)
+of the multigrid cycles. */
 
 struct Poisson {
   scalar a, b;
@@ -261,6 +1112,9 @@ struct Poisson {
 #if EMBED
   double (* embed_flux) (Point, scalar, vector, double *);
 #endif
+#if CACHE_DIAGONAL
+  scalar idiag;
+#endif
 };
 
 /**
@@ -272,7 +1126,9 @@ static void relax (scalar * al, scalar * bl, int l, void * data)
   scalar a = al[0], b = bl[0];
   struct Poisson * p = (struct Poisson *) data;
   (const) face vector alpha = p->alpha;
+#if !CACHE_DIAGONAL
   (const) scalar lambda = p->lambda;
+#endif
 
   /**
   We use either Jacobi (under)relaxation, Gauss-Seidel or we directly
@@ -293,14 +1149,27 @@ static void relax (scalar * al, scalar * bl, int l, void * data)
 #endif
 
   /**
-  On GPUs, we use red/black Gauss-Seidel relaxation, which requires
-  two loops (for odd/even indices). Note also that, unlike the other
-  option, red/black relaxation should be deterministic. */
+  With `CACHE_DIAGONAL`, the inverse of the diagonal coefficient of the
+  operator is computed once for each solution (by
+  [poisson()](#user-interface)) and stored in *idiag*, so that the
+  relaxation is a pure stencil update. With embedded boundaries, the
+  embedded flux still needs to be computed in cut cells, since it
+  depends on the neighbouring values. */
+
+#if CACHE_DIAGONAL
+  scalar idiag = p->idiag;
+#endif
+
+  /**
+  The 5-points (resp. 7-points) Laplacian only couples cells which
+  share a face, so that red/black [multicolour](#multicolour-relaxation)
+  relaxation, which requires two loops, is enough. Unlike the simple
+  traversal, it is deterministic. */
   
-#if GAUSS_SEIDEL || _GPU
-  for (int parity = 0; parity < 2; parity++)
+#if MULTICOLOUR
+  for (int colour = 0; colour < 2; colour++)
     foreach_level_or_leaf (l, nowarning)
-      if (level == 0 || ((point.i + parity) % 2) != (point.j % 2))
+      if (level == 0 || mg_colour (2) == colour)
 #else
   foreach_level_or_leaf (l, nowarning)
 #endif
@@ -310,6 +1179,22 @@ static void relax (scalar * al, scalar * bl, int l, void * data)
     We use the face values of $\alpha$ to weight the gradients of the
     5-points Laplacian operator. We get the relaxation function. */
 
+#if CACHE_DIAGONAL
+    double n = - sq(Delta)*b[];
+    foreach_dimension()
+      n += alpha.x[1]*a[1] + alpha.x[]*a[-1];
+#if EMBED
+    if (p->embed_flux && cs[] > 0. && cs[] < 1.) {
+      double val;
+      p->embed_flux (point, a, alpha, &val);
+      n -= val*sq(Delta);
+    }
+    if (!idiag[])
+      c[] = 0., b[] = 0.;
+    else
+#endif // EMBED
+      c[] = n*idiag[];
+#else // !CACHE_DIAGONAL
     double n = - sq(Delta)*b[], d = - lambda[]*sq(Delta);
     foreach_dimension() {
       n += alpha.x[1]*a[1] + alpha.x[]*a[-1];
@@ -326,6 +1211,7 @@ static void relax (scalar * al, scalar * bl, int l, void * data)
     else
 #endif // EMBED
       c[] = n/d;
+#endif // !CACHE_DIAGONAL
   }
 
   /**
@@ -349,7 +1235,42 @@ static void relax (scalar * al, scalar * bl, int l, void * data)
 /**
 The equivalent residual function is obtained in a similar way in the
 case of a Cartesian grid, however the case of the tree mesh
-requires more careful consideration... */
+requires more careful consideration...
+
+To be conservative, the flux through a face shared with finer cells
+must be the average of the fluxes through the corresponding fine
+faces. Rather than storing the fluxes in a temporary face vector field
+(which would then be restricted), the fine fluxes are computed on the
+fly, using the children of the cell and of its neighbour. This avoids
+writing and reading back a face field, for each call to the residual
+function. The `tree_face_flux_x()` macro returns the flux through the
+left (*i = 0*) or right (*i = 1*) face of the cell.
+
+With embedded boundaries, the gradients through (fine) cut faces are
+not simple differences (see
+[embed_face_gradient_x()](/src/embed.h#operator-overloading)), so the
+fluxes are still stored in a face vector field and restricted. */
+
+#if TREE && !EMBED
+#define tree_fine_flux_x(a,alpha,i,j,k)					\
+  ((is_constant(alpha.x) ? constant(alpha.x) : fine(alpha.x,2*(i),j,k))* \
+   (fine(a,2*(i),j,k) - fine(a,2*(i) - 1,j,k)))
+#if dimension == 1
+# define tree_refined_flux_x(a,alpha,i)			\
+  (2.*tree_fine_flux_x(a,alpha,i,0,0)/Delta)
+#elif dimension == 2
+# define tree_refined_flux_x(a,alpha,i)					\
+  ((tree_fine_flux_x(a,alpha,i,0,0) + tree_fine_flux_x(a,alpha,i,1,0))/Delta)
+#else // dimension == 3
+# define tree_refined_flux_x(a,alpha,i)					\
+  ((tree_fine_flux_x(a,alpha,i,0,0) + tree_fine_flux_x(a,alpha,i,1,0) + \
+    tree_fine_flux_x(a,alpha,i,0,1) + tree_fine_flux_x(a,alpha,i,1,1))/ \
+   (2.*Delta))
+#endif // dimension == 3
+#define tree_face_flux_x(a,alpha,i)					\
+  (is_refined (neighbor(2*(i) - 1)) ? tree_refined_flux_x(a,alpha,i) :	\
+   alpha.x[i]*face_gradient_x (a, i))
+#endif // TREE && !EMBED
 
 static double residual (scalar * al, scalar * bl, scalar * resl, void * data)
 {
@@ -360,13 +1281,21 @@ static double residual (scalar * al, scalar * bl, scalar * resl, void * data)
   double maxres = 0.;
 #if TREE
   /* conservative coarse/fine discretisation (2nd order) */
+#if EMBED
   face vector g[];
   foreach_face()
     g.x[] = alpha.x[]*face_gradient_x (a, 0);
+#endif
   foreach (reduction(max:maxres), nowarning) {
     res[] = b[] - lambda[]*a[];
+#if EMBED
     foreach_dimension()
       res[] -= (g.x[1] - g.x[])/Delta;
+#else
+    foreach_dimension()
+      res[] -= (tree_face_flux_x (a, alpha, 1) -
+		tree_face_flux_x (a, alpha, 0))/Delta;
+#endif
 #if EMBED
     if (p->embed_flux) {
       double c, e = p->embed_flux (point, a, alpha, &c);
@@ -396,6 +1325,135 @@ static double residual (scalar * al, scalar * bl, scalar * resl, void * data)
   return maxres;
 }
 
+/**
+The residual of the correction on a single level, used by the
+[recursive cycles](#recursive-cycles), must be consistent with the
+relaxation function (rather than with the conservative coarse/fine
+discretisation above), so that it vanishes once the relaxation has
+converged. */
+
+static void residual_level (scalar * al, scalar * bl, scalar * resl, int l,
+			    void * data)
+{
+  scalar a = al[0], b = bl[0], res = resl[0];
+  struct Poisson * p = (struct Poisson *) data;
+  (const) face vector alpha = p->alpha;
+#if CACHE_DIAGONAL
+  scalar idiag = p->idiag;
+#else
+  (const) scalar lambda = p->lambda;
+#endif
+  foreach_level_or_leaf (l, nowarning) {
+#if CACHE_DIAGONAL
+    double n = - sq(Delta)*b[];
+    foreach_dimension()
+      n += alpha.x[1]*a[1] + alpha.x[]*a[-1];
+#if EMBED
+    if (p->embed_flux && cs[] > 0. && cs[] < 1.) {
+      double val;
+      p->embed_flux (point, a, alpha, &val);
+      n -= val*sq(Delta);
+    }
+#endif // EMBED
+    res[] = idiag[] ? (a[]/idiag[] - n)/sq(Delta) : 0.;
+#else // !CACHE_DIAGONAL
+    double n = - sq(Delta)*b[], d = - lambda[]*sq(Delta);
+    foreach_dimension() {
+      n += alpha.x[1]*a[1] + alpha.x[]*a[-1];
+      d += alpha.x[1] + alpha.x[];
+    }
+#if EMBED
+    if (p->embed_flux) {
+      double c, e = p->embed_flux (point, a, alpha, &c);
+      n -= c*sq(Delta);
+      d += e*sq(Delta);
+    }
+#endif // EMBED
+    res[] = d ? (d*a[] - n)/sq(Delta) : 0.;
+#endif // !CACHE_DIAGONAL
+  }
+}
+
+/**
+### Coarse-level operator
+
+The operator of the [coarse-level solver](#coarse-level-direct-solver)
+is the discrete operator of the relaxation function, which is not
+defined (yet) when embedded boundaries are used.
+
+The operator depends on the coefficients of the coarse cells, on
+their positions and on the boundary conditions of the unknown. */
+
+static uint64_t mg_coarse_poisson_hash (int level, long * n, void * data)
+{
+  struct Poisson * p = data;
+  (const) face vector alpha = p->alpha;
+  (const) scalar lambda = p->lambda;
+  scalar a = p->a;
+  uint64_t h = mg_hash (MG_HASH_SEED, &MG_COARSE, sizeof (MG_COARSE));
+  h = mg_hash (h, &p->minlevel, sizeof (p->minlevel));
+  h = mg_hash (h, &Period, sizeof (Period));
+  for (int b = 0; b < nboundary; b++)
+    h = mg_hash (h, &a.boundary_homogeneous[b], sizeof (BoundaryFunc));
+  *n = 0;
+  foreach_level (level, serial) {
+    mg_hash_value (h, x);
+    mg_hash_value (h, y);
+    mg_hash_value (h, z);
+    mg_hash_value (h, Delta);
+    mg_hash_value (h, lambda[]);
+    foreach_dimension() {
+      mg_hash_value (h, alpha.x[]);
+      mg_hash_value (h, alpha.x[1]);
+    }
+    (*n)++;
+  }
+  return h;
+}
+
+static MGCoarse * mg_coarse_poisson (struct Poisson * p, int minlevel)
+{
+#if EMBED
+  if (p->embed_flux)
+    return NULL;
+#endif
+  MGCoarse * c = mg_coarse_cached (p->a, mg_coarse_poisson_hash, p);
+  if (c)
+    return c;
+  c = mg_coarse_new (minlevel, grid->maxdepth);
+  if (!c)
+    return NULL;
+  (const) face vector alpha = p->alpha;
+  (const) scalar lambda = p->lambda;
+  scalar * probe = mg_homogeneous_clone ({p->a}), s = probe[0];
+  mg_coarse_probe (c, s);
+  foreach_level (c->level, nowarning) {
+    int row = mg_coarse_index (c), k = 1;
+    c->val[row*MG_COARSE_ROW] += lambda[];
+    foreach_dimension() {
+      c->val[row*MG_COARSE_ROW] -= (alpha.x[] + alpha.x[1])/sq(Delta);
+      mg_coarse_couple (c, row, k++, s[-1], s[], alpha.x[]/sq(Delta));
+      mg_coarse_couple (c, row, k++, s[1], s[], alpha.x[1]/sq(Delta));
+    }
+  }
+  mg_coarse_factor (c);
+  delete (probe), free (probe);
+  long n;
+  mg_coarse_store (c, p->a, mg_coarse_poisson_hash (c->level, &n, p));
+  return c;
+}
+
+/**
+### Direct solvers
+
+For some problems (for example constant coefficients on uniform
+grids, see [poisson-fft.h]()), the equation can be solved directly
+(and faster) than with the multigrid solver. Such a direct solver can
+be set using the hook below. It must return `false` if it cannot solve
+the problem, in which case the multigrid solver is used. */
+
+bool (* poisson_direct) (struct Poisson * p, mgstats * s) = NULL;
+
 /**
 ## User interface
 
@@ -413,7 +1471,10 @@ mgstats poisson (scalar a, scalar b,
 		 int nrelax = 4,
 		 int minlevel = 0,
 		 scalar * res = NULL,
-		 double (* flux) (Point, scalar, vector, double *) = NULL)
+		 double (* flux) (Point, scalar, vector, double *) = NULL,
+		 int krylov = KRYLOV,
+		 int schedule = MG_SCHEDULE,
+		 int cycle = MG_CYCLE)
 {
 
   /**
@@ -448,8 +1509,44 @@ mgstats poisson (scalar a, scalar b,
   else
     p.embed_flux = flux;
 #endif // EMBED
-  mgstats s = mg_solve ({a}, {b}, residual, relax, &p,
-			nrelax, res, max(1, minlevel));
+
+  /**
+  We first try the [direct solver](#direct-solvers), if any. */
+
+  mgstats s;
+  if (poisson_direct && poisson_direct (&p, &s)) {
+    if (tolerance)
+      TOLERANCE = defaultol;
+    return s;
+  }
+
+  /**
+  With `CACHE_DIAGONAL`, we compute the inverse of the diagonal
+  coefficient of the relaxation function on all levels. */
+
+#if CACHE_DIAGONAL
+  scalar idiag[];
+  p.idiag = idiag;
+  for (int l = 0; l <= grid->maxdepth; l++)
+    foreach_level_or_leaf (l) {
+      double d = - lambda[]*sq(Delta);
+      foreach_dimension()
+	d += alpha.x[1] + alpha.x[];
+#if EMBED
+      if (p.embed_flux) {
+	double val;
+	d += p.embed_flux (point, a, alpha, &val)*sq(Delta);
+      }
+#endif // EMBED
+      idiag[] = d ? 1./d : 0.;
+    }
+#endif // CACHE_DIAGONAL
+  MGCoarse * coarse = MG_COARSE > 0 ?
+    mg_coarse_poisson (&p, max(1, minlevel)) : NULL;
+  s = mg_solve ({a}, {b}, residual, relax, &p,
+		nrelax, res, max(1, minlevel), krylov = krylov,
+		schedule = schedule, coarse = coarse, cycle = cycle,
+		level_residual = residual_level);
 
   /**
   We restore the default. */
@@ -481,7 +1578,10 @@ trace
 mgstats project (face vector uf, scalar p,
 		 (const) face vector alpha = unityf,
 		 double dt = 1.,
-		 int nrelax = 4)
+		 int nrelax = 4,
+		 int krylov = KRYLOV,
+		 int schedule = MG_SCHEDULE,
+		 int cycle = MG_CYCLE)
 {
   
   /**
@@ -507,7 +1607,8 @@ mgstats project (face vector uf, scalar p,
   Given the scaling of the divergence above, this gives */
 
   mgstats mgp = poisson (p, div, alpha,
-			 tolerance = TOLERANCE/sq(dt), nrelax = nrelax);
+			 tolerance = TOLERANCE/sq(dt), nrelax = nrelax,
+			 krylov = krylov, schedule = schedule, cycle = cycle);
 
   /**
   And compute $\mathbf{u}_f^{n+1}$ using $\mathbf{u}_f$ and $p$. */
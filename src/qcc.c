@@ -276,15 +276,7 @@ int main (int argc, char ** argv)
   char * openmp = strstr (command, "-fopenmp");
   if (openmp) {
     parallel = 1;
-    if (strstr (command, "-D_MPI")) {
-      fprintf (stderr,
-	       "qcc: warning: OpenMP cannot be used with MPI (yet): "
-	       "switching it off\n");
-      int i;
-      for (i = 0; i < strlen("-fopenmp"); i++)
-	openmp[i] = ' ';
-    }
-    else if (swig) {
+    if (swig) {
       fprintf (stderr,
 	       "qcc: warning: OpenMP cannot be used with Python (yet): "
 	       "switching it off\n");
@@ -20,8 +20,43 @@ static void restriction_tag (Point point, scalar t)
 }
 
 /**
-We also need a few helper functions. The function below implements a
-[binary search](https://en.wikipedia.org/wiki/Binary_search_algorithm)
+Neighborhoods are gathered using a [union-find
+forest](https://en.wikipedia.org/wiki/Disjoint-set_data_structure)
+rather than by iterating until the tags do not change (which requires
+a number of iterations growing with the size of the neighborhoods).
+The array *p* stores the parent *p[i - o]* of each index *i*, and the
+roots of the trees are their own parents. The root of a tree is always
+its minimum index. The function below returns the root of the tree
+containing *i* and halves the path from *i* to the root ("path
+compression"). */
+
+static long tag_find (long * p, long o, long i)
+{
+  while (p[i - o] != i) {
+    long g = p[p[i - o] - o];
+    p[i - o] = g;
+    i = g;
+  }
+  return i;
+}
+
+/**
+This function merges the trees containing *i* and *j*. */
+
+static void tag_union (long * p, long o, long i, long j)
+{
+  i = tag_find (p, o, i), j = tag_find (p, o, j);
+  if (i < j)
+    p[j - o] = i;
+  else if (j < i)
+    p[i - o] = j;
+}
+
+#if _MPI
+/**
+In parallel, we also need a few helper functions. The function below
+implements a [binary
+search](https://en.wikipedia.org/wiki/Binary_search_algorithm)
 of a sorted array. It returns the index in the array so that $a[s] \leq
 tag < a[s+1]$. */
 
@@ -45,7 +80,22 @@ static long lookup_tag (Array * a, double tag)
   return s;
 }
 
-#if _MPI
+static int compar_long (const void * p1, const void * p2)
+{
+  const long * a = p1, * b = p2;
+  return (*a > *b) - (*a < *b);
+}
+
+/**
+This function returns the index of *label* in the sorted array
+*labels* of length *m*, or -1. */
+
+static long lookup_label (const long * labels, long m, long label)
+{
+  long * p = bsearch (&label, labels, m, sizeof (long), compar_long);
+  return p ? p - labels : -1;
+}
+
 static int compar_double (const void * p1, const void * p2)
 {
   const double * a = p1, * b = p2;
@@ -90,78 +140,147 @@ int tag (scalar t)
 #endif // !_MPI
 
   /**
-  To gather cells which belong to the same neighborhood, we repeat
-  multigrid iterations until none of the tag values changes. */
-  
-  bool changed;
-  do {
+  To gather cells which belong to the same neighborhood, we use the
+  union-find algorithm described above. The forest is indexed by the
+  initial tag values of the local leaves, which are between *o* and
+  *o + len - 1*. The forest is empty if there are no such leaves (for
+  example on processes which do not hold any tagged cells). */
+
+  boundary ({t});
+  double tmin = HUGE, tmax = 0.;
+  foreach (serial)
+    if (t[] > 0.) {
+      if (t[] < tmin) tmin = t[];
+      if (t[] > tmax) tmax = t[];
+    }
+  long o = 0, len = 0, * forest = NULL;
+  if (tmax > 0.) {
+    o = tmin, len = tmax - tmin + 1;
+    forest = qcalloc (len, long);
+  }
+  foreach (serial)
+    if (t[] > 0.)
+      forest[(long) t[] - o] = t[];
 
-    /**
-    We first do a restriction from the finest to the coarsest level of
-    the multigrid hierarchy, using the `restriction_tag()` function
-    above. */
-    
-    restriction ({t});
+  /**
+  Each leaf with a non-zero tag is merged with its neighbors (with
+  non-zero tags). Thanks to the restriction and prolongation functions,
+  the neighbors include the coarser leaves (through prolongation) and
+  the finer leaves (through restriction, if all the children have
+  non-zero tags, since they are then all connected together). Tag
+  values which are not local leaves (i.e. which belong to other
+  processes, or which are boundary values) are ignored. */
 
-    /**
-    We then go from the coarsest to the finest level and update the
-    tag values. */
+  foreach (serial)
+    if (t[] > 0.) {
+      long i = t[];
+      foreach_neighbor(1)
+	if (t[] > 0. && t[] != i && t[] == (long) t[]) {
+	  long j = t[];
+	  if (j >= o && j < o + len && forest[j - o])
+	    tag_union (forest, o, i, j);
+	}
+    }
 
-    changed = false;
-    for (int l = 1; l <= grid->maxdepth; l++) {
+  /**
+  Each leaf is then tagged with the root of its tree i.e. the minimum
+  initial tag value of its (local) neighborhood. */
 
-      /**
-      If the parent tag is non-zero, we set the child tag to the value
-      of its parent (i.e. to the minimum tag value of its
-      siblings). */
-      
-      foreach_level(l)
-	if (coarse(t))
-	  t[] = coarse(t);
-      boundary_level ({t}, l);
+  foreach (serial)
+    if (t[] > 0.)
+      t[] = tag_find (forest, o, t[]);
 
-      /**
-      For cells which verify the threshold condition (i.e. for which
-      `t[] != 0`), we refine this initial guess by taking the minimum
-      (non-zero) tag value of its closest neighbors. We also track
-      whether this update changes any of the tag values. */
-      
-      foreach_level (l, reduction(||:changed))
-        if (t[]) {
-	  double min = t[];
-	  foreach_neighbor(1)
-	    if (t[] && t[] < min)
-	      min = t[];
-
-	  /**
-	  On trees, we need to take into account the minimum tag value
-	  of neighboring fine cells. */
-	  
-#if TREE
-	  foreach_dimension()
-	    for (int i = -1; i <= 2; i += 3)
-	      if (is_refined (neighbor((2*i - 1)/3)))
-		for (int j = 0; j <= 1; j++)
-		  for (int k = 0; k <= 1; k++)
-		    if (fine(t,i,j,k) && fine(t,i,j,k) < min)
-		      min = fine(t,i,j,k);
-#endif // TREE
-
-	  if (t[] != min) {
-	    changed = true;
-	    t[] = min;
-	  }
+  /**
+  In serial, the initial tag values are assigned in traversal order,
+  so that the root of each neighborhood (i.e. its minimum initial tag
+  value) is also its first cell in traversal order. The neighborhoods
+  can thus be numbered directly, between one and the number of
+  neighborhoods, in the order of their roots. The forest is used to
+  store the number of each root. */
+
+#if !_MPI
+  int nt = 0;
+  i = 1;
+  foreach (serial) {
+    if (t[] > 0.) {
+      if (t[] == i)
+	forest[i - o] = ++nt;
+      t[] = forest[(long) t[] - o];
+    }
+    i++;
+  }
+  free (forest);
+  return nt;
+#else // _MPI
+
+  /**
+  In parallel, neighborhoods which span several processes need to be
+  merged. The new tags of the neighboring processes are exchanged and
+  each process collects the pairs of (local, remote) tags of
+  neighboring leaves (i.e. the equivalences between local and remote
+  neighborhoods). Remote tags are those which are not local leaves.
+  These pairs are gathered on all processes and merged
+  using a (small) union-find forest indexed by the sorted tags of the
+  pairs. */
+
+  boundary ({t});
+  Array * pairs = array_new();
+  foreach (serial)
+    if (t[] > 0.) {
+      long i = t[];
+      foreach_neighbor(1)
+	if (t[] > 0. && t[] != i && t[] == (long) t[]) {
+	  long ij[2] = {i, t[]};
+	  if (ij[1] < o || ij[1] >= o + len || !forest[ij[1] - o])
+	    array_append (pairs, ij, 2*sizeof (long));
 	}
-      boundary_level ({t}, l);
     }
-  } while (changed);
+
+  int np = pairs->len/sizeof (long), counts[npe()], displs[npe()];
+  MPI_Allgather (&np, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+  int total = 0;
+  for (int k = 0; k < npe(); k++)
+    displs[k] = total, total += counts[k];
+  long * all = qmalloc (total + 1, long);
+  MPI_Allgatherv (pairs->p, np, MPI_LONG, all, counts, displs, MPI_LONG,
+		  MPI_COMM_WORLD);
+  array_free (pairs);
+
+  long * labels = qmalloc (total + 1, long), m = 0;
+  memcpy (labels, all, total*sizeof (long));
+  qsort (labels, total, sizeof (long), compar_long);
+  for (int k = 0; k < total; k++)
+    if (m == 0 || labels[k] != labels[m - 1])
+      labels[m++] = labels[k];
+  long * root = qmalloc (m + 1, long);
+  for (long k = 0; k < m; k++)
+    root[k] = k;
+  for (int k = 0; k < total; k += 2)
+    tag_union (root, 0,
+	       lookup_label (labels, m, all[k]),
+	       lookup_label (labels, m, all[k + 1]));
+  free (all);
+
+  /**
+  Since the labels are sorted, the root of each tree is the minimum
+  tag value of the corresponding neighborhood. */
+
+  foreach (serial)
+    if (t[] > 0.) {
+      long k = lookup_label (labels, m, t[]);
+      if (k >= 0)
+	t[] = labels[tag_find (root, 0, k)];
+    }
+  free (labels);
+  free (root);
+  free (forest);
 
   /**
   ## Reducing the range of indices
 
-  Each neighborhood is now tagged with a unique index. The range of
-  indices is large however (between one and the total number of
-  leaves). The goal of this step is to reduce this range to between
+  Each neighborhood is now tagged with a unique (global) index. The
+  range of indices is large however (between one and the total number
+  of leaves). The goal of this step is to reduce this range to between
   one and the number of neighborhoods. To do this, we create an ordered
   array of unique indices. */
 
@@ -215,7 +334,6 @@ int tag (scalar t)
   We first get the maximum size over all processes of the local map
   and increase the size of the local map to this value. */
 
-#if _MPI
   long lmax = a->len;
   mpi_all_reduce (lmax, MPI_LONG, MPI_MAX);
   a->p = realloc (a->p, lmax);
@@ -247,7 +365,6 @@ int tag (scalar t)
       array_append (a, &p[i], sizeof(double));
       last = p[i];
     }
-#endif // _MPI
 
   /**
   Once we have the (global) map, we can replace the neighborhood
@@ -263,6 +380,7 @@ int tag (scalar t)
   int n = a->len/sizeof(double);
   array_free (a);
   return n;
+#endif // _MPI
 }
 
 static int sort_long (const void * a, const void * b)
@@ -277,7 +395,9 @@ Using tag(), the function below can identify and remove droplets (or
 bubbles) defined by VOF tracer *f* (resp. $1 - f$), smaller than a
 given diameter (*minsize*) expressed in number of
 cells. Alternatively, if *minsize* is negative, the function will keep
-only the `-minsize` largest droplets/bubbles. */
+only the `-minsize` largest droplets/bubbles. The [narrow
+band](/src/vof.h#narrow-band-advection) of *f*, if any, is then
+rebuilt. */
 
 void remove_droplets (scalar f,
 		      int minsize = 3,
@@ -312,4 +432,7 @@ void remove_droplets (scalar f,
   foreach()
     if (d[] > 0 && size[((int) d[]) - 1] < minsize)
       f[] = bubbles;
+#if VOF_BAND
+  vof_band_reset (f);
+#endif
 }
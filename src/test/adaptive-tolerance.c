@@ -0,0 +1,91 @@
+/**
+# Adaptive tolerance of the multigrid solvers
+
+We compare the number of iterations of the multigrid solvers, for the
+lid-driven cavity at Re = 100 (see also
+[pressure-extrapolation.c](pressure-extrapolation.c)), when the
+tolerance is constant or [adapted](/src/navier-stokes/adaptive-tolerance.h)
+to the initial residuals. The tolerance is constant when
+*TOLERANCE_FACTOR* is zero. */
+
+#include "navier-stokes/centered.h"
+#include "navier-stokes/adaptive-tolerance.h"
+#include "navier-stokes/perfs.h"
+
+u.t[top]    = dirichlet(1);
+u.t[bottom] = dirichlet(0);
+u.t[left]   = dirichlet(0);
+u.t[right]  = dirichlet(0);
+
+uf.n[left]   = 0;
+uf.n[right]  = 0;
+uf.n[top]    = 0;
+uf.n[bottom] = 0;
+
+int main()
+{
+  origin (-0.5, -0.5);
+  mu[] = {1e-2,1e-2};
+  DT = 0.1 [0,1];
+  TOLERANCE = 1e-7 [*];
+  TOLERANCE_MAX = 1e-3;
+  for (TOLERANCE_FACTOR = 0.; TOLERANCE_FACTOR <= 0.1;
+       TOLERANCE_FACTOR += 0.1) {
+    init_grid (64);
+    run();
+  }
+}
+
+/**
+We record the total number of iterations of each solver, for the
+transient ($t < 1.5$) and quasi-steady phases. */
+
+int niter[2][3];
+
+event init (i = 0)
+{
+  for (int j = 0; j < 2; j++)
+    for (int k = 0; k < 3; k++)
+      niter[j][k] = 0;
+}
+
+event logfile (i++) {
+  int j = t > 1.5;
+  niter[j][0] += mgp.i, niter[j][1] += mgpf.i, niter[j][2] += mgu.i;
+  printf ("%g %d %g %d %d %d %g %g %g\n", TOLERANCE_FACTOR, i, t,
+	  mgp.i, mgpf.i, mgu.i, tolp, tolpf, tolu);
+}
+
+/**
+The solution is not changed significantly by the adaptive
+tolerance. */
+
+event end (t = 3) {
+  stats s = statsf (u.x);
+  fprintf (stderr, "%g %d %d %d %d %d %d %.4f %.4f\n", TOLERANCE_FACTOR,
+	   niter[0][0], niter[0][1], niter[0][2],
+	   niter[1][0], niter[1][1], niter[1][2], s.min, s.max);
+}
+
+/**
+## Results
+
+The numbers of iterations (for the projection, the projection of the
+advection velocity and the viscous problem, in the transient and
+quasi-steady phases) are reduced by a factor of two to three, while
+the solution is unchanged.
+
+~~~bash
+0 579 509 1106 360 332 1150 -0.2372 0.9499
+0.1 166 184 453 217 206 460 -0.2372 0.9499
+~~~
+
+~~~gnuplot Tolerance of the projection
+set xlabel 'Timestep'
+set ylabel 'Tolerance'
+set logscale y
+plot '< grep "^0.1 " out' u 2:7 w l t 'projection', \
+     '< grep "^0.1 " out' u 2:8 w l t 'advection velocity', \
+     '< grep "^0.1 " out' u 2:9 w l t 'viscosity'
+~~~
+*/
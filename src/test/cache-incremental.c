@@ -0,0 +1,148 @@
+/**
+# Incremental updates of tree caches
+
+After a mesh adaptation, the caches of the tree are patched
+[incrementally](/src/grid/tree.h#incremental-cache-updates) when only
+a few cells have been refined or coarsened, and are rebuilt entirely
+otherwise. We check that the incremental updates give exactly the same
+caches as full updates, for sequences of refinements and coarsenings
+of different sizes. */
+
+#include "utils.h"
+
+/**
+The function below returns a copy of the leaves, faces and vertices
+caches and of the caches of each level. */
+
+typedef struct {
+  Index * c[3];
+  int n[3];
+  IndexLevel * l[4][20];
+  int nl[4][20];
+} Caches;
+
+static Caches caches_copy (void)
+{
+  Caches s;
+  Cache * c[3] = {&tree->leaves, &tree->faces, &tree->vertices};
+  for (int i = 0; i < 3; i++) {
+    s.n[i] = c[i]->n;
+    s.c[i] = malloc ((c[i]->n + 1)*sizeof (Index));
+    for (int k = 0; k < c[i]->n; k++)
+      s.c[i][k] = cache_index (c[i], k);
+  }
+  assert (depth() < 20);
+  for (int l = 0; l <= depth(); l++) {
+    CacheLevel * cl[4] = {&tree->active[l], &tree->prolongation[l],
+			  &tree->boundary[l], &tree->restriction[l]};
+    for (int i = 0; i < 4; i++) {
+      s.nl[i][l] = cl[i]->n;
+      s.l[i][l] = malloc ((cl[i]->n + 1)*sizeof (IndexLevel));
+      memcpy (s.l[i][l], cl[i]->p, cl[i]->n*sizeof (IndexLevel));
+    }
+  }
+  return s;
+}
+
+static void caches_free (Caches s)
+{
+  for (int i = 0; i < 3; i++)
+    free (s.c[i]);
+  for (int l = 0; l <= depth(); l++)
+    for (int i = 0; i < 4; i++)
+      free (s.l[i][l]);
+}
+
+/**
+This returns the number of caches which differ between *a* and *b*. */
+
+static int caches_differ (Caches a, Caches b)
+{
+  int nd = 0;
+  for (int i = 0; i < 3; i++)
+    if (a.n[i] != b.n[i])
+      nd++;
+    else
+      for (int k = 0; k < a.n[i]; k++) {
+	Index p = a.c[i][k], q = b.c[i][k];
+	if (p.i != q.i ||
+#if dimension >= 2
+	    p.j != q.j ||
+#endif
+#if dimension >= 3
+	    p.k != q.k ||
+#endif
+	    p.level != q.level || p.flags != q.flags) {
+	  nd++;
+	  break;
+	}
+      }
+  for (int l = 0; l <= depth(); l++)
+    for (int i = 0; i < 4; i++)
+      if (a.nl[i][l] != b.nl[i][l] ||
+	  memcmp (a.l[i][l], b.l[i][l], a.nl[i][l]*sizeof (IndexLevel)))
+	nd++;
+  return nd;
+}
+
+/**
+The caches are updated (incrementally or not), copied and compared
+with those obtained with a full update. We display the number of
+incremental and full updates and the number of differing caches. */
+
+static void check (const char * name)
+{
+  static long nis = 0, nfs = 0;
+  update_cache();
+  long ni = cache_updates.nincremental - nis, nf = cache_updates.nfull - nfs;
+  Caches a = caches_copy();
+  tree->dirty = true;
+  update_cache();
+  Caches b = caches_copy();
+  fprintf (stderr, "%s %ld %ld %d %ld\n", name, ni, nf, caches_differ (a, b),
+	   grid->n);
+  caches_free (a), caches_free (b);
+  nis = cache_updates.nincremental, nfs = cache_updates.nfull;
+}
+
+int main()
+{
+  size (1. [0]);
+  origin (-0.5, -0.5, -0.5);
+  init_grid (8);
+  check ("start");
+
+  /**
+  The initial refinement is large and uses a full update. */
+
+  refine (level < 6 && fabs (sqrt (sq(x) + sq(y) + sq(z)) - 0.25) < 0.05);
+  check ("init");
+
+  /**
+  A few cells are refined, then coarsened, which uses incremental
+  updates. The cells are close to the boundaries of the domain, so
+  that the boundary caches are updated. */
+
+  refine (level < 6 && x < -0.4 && y < -0.4);
+  check ("refine");
+  unrefine (level >= 5 && x < -0.4 && y < -0.4);
+  check ("unrefine");
+
+  /**
+  The mesh is adapted to a moving disk. */
+
+  scalar c[];
+  for (int i = 0; i < 10; i++) {
+    foreach()
+      c[] = sq(x - 0.02*i) + sq(y) + sq(z) < sq(0.25);
+    adapt_wavelet ({c}, (double[]){1e-2}, 6, 3);
+    check ("adapt");
+  }
+
+  /**
+  Coarsening most of the mesh uses a full update (the number of
+  changed cells is larger than the number of leaves). */
+
+  unrefine (level >= 4);
+  check ("coarsen");
+}
@@ -0,0 +1,63 @@
+/**
+# Compaction of tree layers
+
+After coarsening most of a refined mesh, the sparsely-used layers of
+the tree are [compacted](/src/grid/tree.h#tree_compact) when
+*tree_min_occupancy* is set. We check that the mesh and the values of
+the fields are unchanged by compaction and that the memory used by the
+layers (their pools and, with FIELD_MAJOR, their field arrays)
+decreases. */
+
+static long layers_memory (void)
+{
+  long mem = 0;
+  for (int l = 1; l <= depth(); l++) {
+    Layer * L = tree->L[l];
+    mem += mempool_capacity (L->pool)*L->pool->size;
+#if FIELD_MAJOR
+    mem += L->nm*datasize;
+#endif
+  }
+  return mem;
+}
+
+int main()
+{
+  origin (-0.5, -0.5);
+  init_grid (1);
+  refine (level < 9);
+  scalar s[];
+  foreach()
+    s[] = x + 2.*y;
+  long before = layers_memory();
+
+  tree_min_occupancy = 0.5;
+  unrefine (level > 4 && sq(x) + sq(y) > sq(0.2));
+  tree_check();
+
+  /**
+  The field is linear, so that its restriction is exact. */
+
+  double emax = 0.;
+  long n = 0;
+  foreach (reduction(max:emax) reduction(+:n)) {
+    double e = fabs (s[] - x - 2.*y);
+    if (e > emax)
+      emax = e;
+    n++;
+  }
+  fprintf (stderr, "leaves: %ld error: %g compacted: %d\n",
+	   n, emax, layers_memory() < before/2);
+
+  /**
+  The mesh is refined again, which reuses the compacted layers. */
+
+  refine (level < 7 && sq(x) + sq(y) > sq(0.3));
+  foreach()
+    s[] = x + 2.*y;
+  tree_check();
+  n = 0;
+  foreach (reduction(+:n))
+    n++;
+  fprintf (stderr, "leaves: %ld\n", n);
+}
@@ -0,0 +1,96 @@
+/**
+# Droplet statistics
+
+We check the [droplet statistics](/src/droplets.h) for three circular
+droplets on an adaptive mesh, in serial and in parallel. The velocity
+field is $\mathbf{u} = (x, y)$ so that the average velocity of each
+droplet is equal to its centroid. */
+
+#include "utils.h"
+#include "droplets.h"
+
+#define R0 0.1
+
+coord c0[3] = {{-0.2, -0.15}, {0.25, 0.2}, {-0.1, 0.3}};
+double r0[3] = {R0, R0/2., 1.5*R0};
+
+int main()
+{
+  origin (-0.5, -0.5);
+  init_grid (32);
+  refine (level < 7 && fabs (sqrt (sq(x - c0[0].x) + sq(y - c0[0].y)) - r0[0]) < 0.05);
+  refine (level < 6 && fabs (sqrt (sq(x - c0[2].x) + sq(y - c0[2].y)) - r0[2]) < 0.05);
+
+  vertex scalar phi[];
+  foreach_vertex() {
+    phi[] = HUGE;
+    for (int j = 0; j < 3; j++)
+      phi[] = min (phi[], sqrt (sq(x - c0[j].x) + sq(y - c0[j].y)) - r0[j]);
+    phi[] = - phi[];
+  }
+  scalar f[];
+  fractions (phi, f);
+  vector u[];
+  foreach() {
+    u.x[] = x;
+    u.y[] = y;
+  }
+
+  /**
+  The volumes and areas are compared with those of the exact circles,
+  and the velocities with the centroids. */
+
+  droplet * d;
+  int n = droplet_census (f, &d, u);
+  fprintf (stderr, "%d\n", n);
+  for (int j = 0; j < n; j++) {
+    int k = 0;
+    while (k < 2 && sq(d[j].centroid.x - c0[k].x) +
+	   sq(d[j].centroid.y - c0[k].y) > sq(r0[k]))
+      k++;
+    fprintf (stderr, "%d %d %.3f %.3f %.4f %.4f %d %.4f %.4f %.4f %.4f\n",
+	     j + 1, k, d[j].volume/(pi*sq(r0[k])), d[j].area/(2.*pi*r0[k]),
+	     d[j].centroid.x, d[j].centroid.y,
+	     fabs (d[j].velocity.x - d[j].centroid.x) < 1e-12 &&
+	     fabs (d[j].velocity.y - d[j].centroid.y) < 1e-12,
+	     d[j].min.x, d[j].min.y, d[j].max.x, d[j].max.y);
+  }
+
+  /**
+  There is a single bubble. */
+
+  droplet * b;
+  fprintf (stderr, "bubbles %d\n", droplet_census (f, &b, bubbles = true));
+  free (b);
+
+  /**
+  We check that the binary output contains the same statistics. */
+
+  FILE * fp = fopen ("droplets.bin", "w+");
+  output_droplets (f, u, fp, binary = true);
+  if (pid() == 0) {
+    rewind (fp);
+    int i1, n1;
+    double t1, a[2 + 4*dimension];
+    bool same = (fread (&i1, sizeof (int), 1, fp) == 1 &&
+		 fread (&t1, sizeof (double), 1, fp) == 1 &&
+		 fread (&n1, sizeof (int), 1, fp) == 1 &&
+		 i1 == iter && t1 == t && n1 == n);
+    for (int j = 0; j < n && same; j++)
+      same = (fread (a, sizeof (double), 2 + 4*dimension, fp) ==
+	      2 + 4*dimension &&
+	      a[0] == d[j].volume && a[1] == d[j].area &&
+	      a[2] == d[j].centroid.x && a[3] == d[j].centroid.y &&
+	      a[4] == d[j].velocity.x && a[5] == d[j].velocity.y &&
+	      a[6] == d[j].min.x && a[7] == d[j].min.y &&
+	      a[8] == d[j].max.x && a[9] == d[j].max.y);
+    fprintf (stderr, "binary %d\n", same);
+  }
+  fclose (fp);
+  free (d);
+
+  /**
+  The CSV output is written on standard output. */
+
+  output_droplets (f, u);
+}
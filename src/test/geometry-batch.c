@@ -0,0 +1,147 @@
+/**
+# Batched geometric functions
+
+We check that the [batched functions](/src/geometry.h#batched-functions)
+give exactly the same results as the corresponding scalar functions,
+for random interfaces (including degenerate interfaces aligned with the
+cell faces and full or empty cells), and we compare their speed. */
+
+#include "grid/multigrid.h"
+#include "geometry.h"
+#include "utils.h"
+
+/**
+The function below counts the number of results which differ. */
+
+static int differ (int n, const double * a, const double * b)
+{
+  int nd = 0;
+  for (int i = 0; i < n; i++)
+    if (a[i] != b[i])
+      nd++;
+  return nd;
+}
+
+int main()
+{
+  int n = 1 << 20;
+  double * c = malloc (n*sizeof (double)), * alpha = malloc (n*sizeof (double));
+  double * f = calloc (n, sizeof (double)), * g = calloc (n, sizeof (double));
+  coord_array m;
+  foreach_dimension()
+    m.x = malloc (n*sizeof (double));
+  for (int i = 0; i < n; i++)
+    f[i] = g[i] = 0.;
+
+  /**
+  The normals are normalised as those returned by
+  [interface_normal()](/src/fractions.h#interface_normal). One
+  interface in sixteen is aligned with one of the faces and one in
+  sixteen is empty or full. */
+
+  for (int i = 0; i < n; i++) {
+    coord mi;
+    double sum = 0.;
+    foreach_dimension() {
+      mi.x = noise();
+      sum += fabs (mi.x);
+    }
+    foreach_dimension()
+      mi.x /= sum;
+    if (i % 16 == 0)
+      foreach_dimension()
+	mi.x = 0.;
+    if (i % 16 == 0)
+      mi.x = 1.;
+    foreach_dimension()
+      m.x[i] = mi.x;
+    c[i] = (noise() + 1.)/2.;
+    if (i % 16 == 8)
+      c[i] = c[i] > 0.5;
+  }
+
+  /**
+  The scalar and batched versions of each function are compared. */
+
+  timer t = timer_start();
+  for (int i = 0; i < n; i++) {
+    coord mi;
+    foreach_dimension()
+      mi.x = m.x[i];
+    alpha[i] = plane_alpha (c[i], mi);
+  }
+  double ts = timer_elapsed (t);
+  t = timer_start();
+  plane_alpha_batch (n, c, m, f);
+  double tb = timer_elapsed (t);
+  fprintf (stderr, "plane_alpha %d\n", differ (n, alpha, f));
+  printf ("plane_alpha %g %g\n", ts, tb);
+
+  t = timer_start();
+  for (int i = 0; i < n; i++) {
+    coord mi;
+    foreach_dimension()
+      mi.x = m.x[i];
+    f[i] = plane_volume (mi, alpha[i]);
+  }
+  ts = timer_elapsed (t);
+  t = timer_start();
+  plane_volume_batch (n, m, alpha, g);
+  tb = timer_elapsed (t);
+  fprintf (stderr, "plane_volume %d\n", differ (n, f, g));
+  printf ("plane_volume %g %g\n", ts, tb);
+
+  /**
+  The volume fractions are consistent with the intercepts. */
+
+  double emax = 0.;
+  for (int i = 0; i < n; i++)
+    if (fabs (g[i] - clamp (c[i], 0., 1.)) > emax)
+      emax = fabs (g[i] - clamp (c[i], 0., 1.));
+  fprintf (stderr, "consistency %d\n", emax < 1e-10);
+
+  coord a = {-0.5, -0.5, -0.5}, b = {0.2, 0.5, 0.5};
+  t = timer_start();
+  for (int i = 0; i < n; i++) {
+    coord mi;
+    foreach_dimension()
+      mi.x = m.x[i];
+    f[i] = rectangle_fraction (mi, alpha[i], a, b);
+  }
+  ts = timer_elapsed (t);
+  t = timer_start();
+  rectangle_fraction_batch (n, m, alpha, a, b, g);
+  tb = timer_elapsed (t);
+  fprintf (stderr, "rectangle_fraction %d\n", differ (n, f, g));
+  printf ("rectangle_fraction %g %g\n", ts, tb);
+
+  free (c), free (alpha), free (f), free (g);
+  foreach_dimension()
+    free (m.x);
+}
+
+/**
+## Results
+
+The batched functions give the same results as the scalar functions.
+The times (in seconds, for $2^{20}$ interfaces) of the scalar and
+batched versions are, with the default compilation flags (`-O2`):
+
+~~~bash
+plane_alpha 0.111 0.062
+plane_volume 0.078 0.083
+rectangle_fraction 0.074 0.086
+~~~
+
+and when the loops are vectorised (`-O3 -fno-math-errno
+-fno-trapping-math`):
+
+~~~bash
+plane_alpha 0.094 0.026
+plane_volume 0.065 0.031
+rectangle_fraction 0.071 0.025
+~~~
+
+The branch-free intercept is faster even without vectorisation,
+because the branches of *line_alpha()* are poorly predicted, while
+those of *line_area()* are not. */
@@ -0,0 +1,80 @@
+/**
+# Speed and memory use of the different Memindex implementations
+
+The `Memindex` structure of [tree.h](/src/grid/tree.h) can be
+implemented using either [virtual](/src/grid/memindex/virtual.h)
+memory (the default), [ranges](/src/grid/memindex/range.h) of
+one-dimensional arrays (with `-DMEMINDEX_RANGE=1`) or a [hash
+table](/src/grid/memindex/hash.h) of tiles (with `-DMEMINDEX_HASH=1`).
+
+This code is compiled with each implementation. We refine an octree
+around the surface of a sphere (a typical adaptive mesh) and vary the
+maximum level from 5 to 8. For each level, we measure the time
+necessary to apply a 7-points Laplacian operator (which accesses the
+neighbouring cells) and the maximum memory used by the process. */
+
+#include "grid/octree.h"
+#include "utils.h"
+
+scalar a[], b[];
+
+int main (int argc, char * argv[])
+{
+  size (1.[0]); // dimensionless
+  origin (-0.5, -0.5, -0.5);
+  int start = 5, end = 8;
+  if (argc > 1)
+    start = end = atoi(argv[1]);
+  for (int l = start; l <= end; l++) {
+    init_grid (1 << 3);
+    refine (level < l && fabs (sqrt(sq(x) + sq(y) + sq(z)) - 0.25) < 2.*Delta);
+
+    foreach()
+      a[] = cos(2.*pi*x)*sin(2.*pi*y)*cos(2.*pi*z);
+
+    /**
+    The number of loops is inversely proportional to the number of
+    leaf cells so that times are comparable on all meshes. */
+
+    long n = 0;
+    foreach (reduction(+:n))
+      n++;
+    int nloops = max (1, (1 << 24)/n), i = nloops;
+
+    timer tm = timer_start();
+    while (i--)
+      foreach()
+	b[] = (a[1] + a[-1] + a[0,1] + a[0,-1] + a[0,0,1] + a[0,0,-1]
+	       - 6.*a[])/sq(Delta);
+    double t = timer_elapsed (tm);
+
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    printf ("%d %ld %g %ld\n", l, n, 1e9*t/(nloops*n), usage.ru_maxrss);
+  }
+}
+
+/**
+## Results
+
+The first graph shows the time per leaf cell for the Laplacian
+operator and the second graph the maximum memory used (in kilobytes)
+per leaf cell.
+
+~~~gnuplot Speed of the 7-points Laplacian for each implementation
+set xlabel 'Level'
+set ylabel 'nanoseconds per leaf cell'
+set key top left
+plot '../memindex/out' u 1:3 w lp t 'Virtual', \
+     '../memindex-range/out' u 1:3 w lp t 'Range', \
+     '../memindex-hash/out' u 1:3 w lp t 'Hash'
+~~~
+
+~~~gnuplot Maximum memory per leaf cell
+set ylabel 'kilobytes per leaf cell'
+set logscale y
+plot '../memindex/out' u 1:($4/$2) w lp t 'Virtual', \
+     '../memindex-range/out' u 1:($4/$2) w lp t 'Range', \
+     '../memindex-hash/out' u 1:($4/$2) w lp t 'Hash'
+~~~
+*/
@@ -0,0 +1,25 @@
+/**
+# Undefined values in single precision on a 1D Cartesian grid
+
+The storage of [Cartesian 1D grids](/src/grid/cartesian1D.h) is always
+in double precision, so that the "undefined" values used to initialise
+them must also be double precision signaling NaNs, even when compiled
+with `-DSINGLE_PRECISION=1`. Converting the single precision
+signaling NaN would raise a floating-point exception. */
+
+#include "grid/cartesian1D.h"
+#include "utils.h"
+
+int main()
+{
+  init_grid (32);
+  scalar s[];
+
+  /**
+  The grid is reinitialised with an allocated field. */
+
+  init_grid (64);
+  foreach()
+    s[] = x;
+  fprintf (stderr, "%g\n", statsf(s).sum);
+}
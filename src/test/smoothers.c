@@ -0,0 +1,106 @@
+/**
+# Relaxation schemes of the multigrid solvers
+
+This code is compiled with the different [relaxation
+schemes](/src/poisson.h#multicolour-relaxation): "re-use as soon as
+computed" (the default without OpenMP), weighted Jacobi (with
+`-DJACOBI=1`) and multicolour Gauss--Seidel (with `-DGAUSS_SEIDEL=1`,
+the default with OpenMP).
+
+We solve the Poisson equation of [poisson.c](poisson.c) and a
+(coupled) viscous diffusion problem for decreasing tolerances and
+record the number of multigrid iterations and the corresponding
+time. Multicolour relaxation does not depend on the order in which
+cells are traversed, so that the results obtained with OpenMP must be
+identical to those obtained serially.
+
+With `-DCACHE_DIAGONAL=1`, the inverse diagonal coefficients of the
+relaxation functions are precomputed, which must not change the
+results (apart from round-off errors). */
+
+#include "utils.h"
+#include "viscosity.h"
+
+scalar a[], b[];
+vector u[];
+
+double solution (double x, double y, double z)
+{
+  return cos(3.*pi*x)*cos(3.*pi*y)*cos(3.*pi*z);
+}
+
+int main()
+{
+  foreach_dimension() {
+    a[right] = dirichlet (solution(x, y, z));
+    a[left]  = dirichlet (solution(x, y, z));
+  }
+
+  size (1. [0]); // dimensionless
+  origin (-0.5, -0.5, -0.5);
+  init_grid (1 << 8);
+
+  foreach()
+    b[] = - 9.*dimension*pi*pi*solution(x, y, z);
+
+  for (double tolerance = 1e-3; tolerance > 1e-10; tolerance /= 100.) {
+    foreach()
+      a[] = 0.;
+    timer start = timer_start();
+    mgstats s = poisson (a, b, tolerance = tolerance);
+    double t = timer_elapsed (start);
+    double max = 0.;
+    foreach (reduction(max:max))
+      if (fabs(a[] - solution(x, y, z)) > max)
+	max = fabs(a[] - solution(x, y, z));
+    fprintf (stderr, "poisson %g %d %d %.12g %.12g\n",
+	     tolerance, s.i, s.nrelax, s.resa, max);
+    printf ("poisson %g %d %g\n", tolerance, s.i, t);
+  }
+
+  /**
+  For the viscous problem, we use a variable density. Jacobi
+  relaxation requires more iterations than the default maximum. */
+
+  NITERMAX = 500;
+
+  scalar rho[];
+  foreach()
+    rho[] = 1. + 10.*(sq(x) + sq(y) < sq(0.25));
+  for (double tolerance = 1e-3; tolerance > 1e-10; tolerance /= 100.) {
+    foreach()
+      foreach_dimension()
+	u.x[] = solution(x, y, z);
+    TOLERANCE = tolerance;
+    timer start = timer_start();
+    mgstats s = viscosity (u, unityf, rho, 1e-2);
+    double t = timer_elapsed (start);
+    double max = 0.;
+    foreach (reduction(max:max))
+      if (fabs(u.x[]) > max)
+	max = fabs(u.x[]);
+    fprintf (stderr, "viscosity %g %d %d %.12g %.12g\n",
+	     tolerance, s.i, s.nrelax, s.resa, max);
+    printf ("viscosity %g %d %g\n", tolerance, s.i, t);
+  }
+}
+
+/**
+## Results
+
+~~~gnuplot Convergence of the Poisson solver
+set xlabel 'Time (sec)'
+set ylabel 'Tolerance'
+set logscale
+set key bottom left
+plot '< grep poisson ../smoothers/out' u 4:2 w lp t 'Re-use', \
+     '< grep poisson ../smoothers-jacobi/out' u 4:2 w lp t 'Jacobi', \
+     '< grep poisson ../smoothers-gs/out' u 4:2 w lp t 'Multicolour'
+~~~
+
+~~~gnuplot Convergence of the viscous solver
+plot '< grep viscosity ../smoothers/out' u 4:2 w lp t 'Re-use', \
+     '< grep viscosity ../smoothers-jacobi/out' u 4:2 w lp t 'Jacobi', \
+     '< grep viscosity ../smoothers-gs/out' u 4:2 w lp t 'Multicolour'
+~~~
+*/
@@ -0,0 +1,57 @@
+/**
+# Tagging on adaptive and periodic meshes
+
+We check that [tag()](/src/tag.h) gives the same neighborhoods (and
+the same tags) in serial and in parallel, on an adaptive mesh with
+periodic boundaries. The neighborhoods are thin, winding bands, which
+span several processes and cross the periodic boundaries. Some of
+them are connected only through the corner of a coarse and a fine
+leaf. A second case has a single small neighborhood, so that most
+processes do not hold any tagged cell. */
+
+#include "utils.h"
+#include "tag.h"
+
+/**
+We display the number of cells of each neighborhood. */
+
+void output_sizes (scalar t, int n)
+{
+  long size[n];
+  for (int i = 0; i < n; i++)
+    size[i] = 0;
+  foreach (serial)
+    if (t[] > 0)
+      size[((int) t[]) - 1]++;
+#if _MPI
+  MPI_Allreduce (MPI_IN_PLACE, size, n, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+#endif
+  fprintf (stderr, "%d\n", n);
+  for (int i = 0; i < n; i++)
+    fprintf (stderr, "%d %ld\n", i + 1, size[i]);
+}
+
+int main()
+{
+  size (1. [0]);
+  origin (-0.5, -0.5);
+  periodic (right);
+  init_grid (64);
+  refine (level < 8 && (sq(x - 0.1) + sq(y + 0.05) < sq(0.2) ||
+			fabs(x + 0.3) < 0.05));
+  unrefine (level > 5 && x > 0.3 && y > 0.);
+
+  scalar t[];
+  foreach()
+    t[] = fabs (y - 0.3*sin (4.*pi*x)) < 0.03 ||
+    fabs (y + 0.25 - 0.1*cos (6.*pi*x)) < 0.01 ||
+    sq(x - 0.1) + sq(y + 0.05) < sq(0.05) || x > 0.45 || x < -0.47;
+  int n = tag (t);
+
+  output_sizes (t, n);
+
+  foreach()
+    t[] = sq(x + 0.45) + sq(y + 0.45) < sq(0.03);
+  n = tag (t);
+  output_sizes (t, n);
+}
@@ -0,0 +1,27 @@
+/**
+# Parallel coarsening
+
+We check that [unrefine()](/src/grid/tree-common.h) gives the same
+mesh when its condition is evaluated in parallel (with OpenMP) and
+serially. */
+
+static long leaves (void)
+{
+  long n = 0;
+  foreach (reduction(+:n))
+    n++;
+  return n;
+}
+
+int main()
+{
+  origin (-0.5, -0.5);
+  for (int parallel = 0; parallel <= 1; parallel++) {
+    init_grid (1);
+    refine (level < 8);
+    unrefine (level > 4 && sq(x) + sq(y) > sq(0.3), parallel);
+    tree_check();
+    fprintf (stderr, "%d %d %ld\n", parallel, depth(), leaves());
+    free_grid();
+  }
+}
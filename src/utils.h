@@ -123,6 +123,13 @@ void timer_print (timer t, int i, size_t tnc)
 	   s.min, 100.*s.min/s.real,
 	   s.avg, 100.*s.avg/s.real,
 	   s.max, 100.*s.max/s.real);
+#endif
+#if TREE
+  if (cache_updates.nincremental > 0)
+    fprintf (fout,
+	     "# cache updates: %ld full (%.2g), %ld incremental (%.2g)\n",
+	     cache_updates.nfull, cache_updates.tfull,
+	     cache_updates.nincremental, cache_updates.tincremental);
 #endif
   fflush (stdout);
 }
@@ -53,6 +53,9 @@ struct Viscosity {
   face vector mu;
   scalar rho;
   double dt;
+#if CACHE_DIAGONAL
+  vector idiag;
+#endif
 };
 
 /**
@@ -141,25 +144,25 @@ static void relax_viscosity (scalar * a, scalar * b, int l, void * data)
 #endif
 
   /**
-  We have the option of using red/black Gauss-Seidel relaxation or
-  "re-use as soon as computed" relaxation. On GPUs (and probably also
-  with OpenMP) red/black Gauss-Seidel converges much better (but
-  requires two foreach() iterations). Note also that, unlike the other
-  option, red/black relaxation should be deterministic. */
-  
-#if GAUSS_SEIDEL || _GPU
-  vector ua[];
-  foreach_level (l)
-    foreach_dimension()
-      ua.x[] = u.x[];
-  boundary_level ((scalar *){ua}, l);
-  for (int parity = 0; parity < 2; parity++)
-    foreach_level_or_leaf (l)
-      if (level == 0 || ((point.i + parity) % 2) != (point.j % 2))
-#else
+  We have the option of using [multicolour](/src/poisson.h#multicolour-relaxation)
+  Gauss-Seidel relaxation or "re-use as soon as computed"
+  relaxation. The stencil includes the diagonal neighbours (through
+  the cross-derivative terms) so that we need $2^d$ colours (i.e. 4
+  loops in 2D and 8 loops in 3D). On GPUs and with OpenMP, multicolour
+  relaxation is used by default since it is deterministic and
+  converges much better than Jacobi relaxation. */
+
 #if dimension > 1
   vector ua = u;
 #endif
+#if CACHE_DIAGONAL
+  vector idiag = p->idiag;
+#endif
+#if MULTICOLOUR
+  for (int colour = 0; colour < 1 << dimension; colour++)
+    foreach_level_or_leaf (l, nowarning)
+      if (level == 0 || mg_colour (1 << dimension) == colour)
+#else
   foreach_level_or_leaf (l)
 #endif
   {
@@ -181,8 +184,11 @@ static void relax_viscosity (scalar * a, scalar * b, int l, void * data)
 						     (ua.z[1,0,-1] + u.z[1,0,0])/4. -
 						     (ua.z[-1,0,-1] + u.z[-1,0,0])/4.)
 #endif
-					   ))/
-      (lambda.x*sq(Delta) + dt/rho[]*(2.*mu.x[1] + 2.*mu.x[]
+					   ))
+#if CACHE_DIAGONAL
+      *idiag.x[];
+#else
+      /(lambda.x*sq(Delta) + dt/rho[]*(2.*mu.x[1] + 2.*mu.x[]
 #if dimension > 1
 				      + mu.y[0,1] + mu.y[]
 #endif
@@ -190,6 +196,7 @@ static void relax_viscosity (scalar * a, scalar * b, int l, void * data)
 				      + mu.z[0,0,1] + mu.z[]
 #endif
 				      ));
+#endif // !CACHE_DIAGONAL
   }
 
 #if JACOBI
@@ -292,6 +299,32 @@ static double residual_viscosity (scalar * a, scalar * b, scalar * resl,
   return maxres;
 }
 
+#if CACHE_DIAGONAL
+/**
+With `CACHE_DIAGONAL`, the inverses of the diagonal coefficients of
+the relaxation function are computed once for all levels, before
+calling the multigrid solver. */
+
+static void viscosity_diagonal (struct Viscosity * p, vector idiag)
+{
+  (const) face vector mu = p->mu;
+  (const) scalar rho = p->rho;
+  double dt = p->dt;
+  p->idiag = idiag;
+  for (int l = 0; l <= grid->maxdepth; l++)
+    foreach_level_or_leaf (l)
+      foreach_dimension()
+	idiag.x[] = 1./(lambda.x*sq(Delta) + dt/rho[]*(2.*mu.x[1] + 2.*mu.x[]
+#if dimension > 1
+						       + mu.y[0,1] + mu.y[]
+#endif
+#if dimension > 2
+						       + mu.z[0,0,1] + mu.z[]
+#endif
+						       ));
+}
+#endif // CACHE_DIAGONAL
+
 #undef lambda
 
 /**
@@ -303,7 +336,8 @@ A user interface is provided for the solution of the viscous diffusion equation.
 
 trace
 mgstats viscosity (vector u, face vector mu, scalar rho, double dt,
-		   int nrelax = 4, scalar * res = NULL)
+		   int nrelax = 4, scalar * res = NULL, int krylov = KRYLOV,
+		   int schedule = MG_SCHEDULE)
 {
   
   /**
@@ -320,8 +354,14 @@ mgstats viscosity (vector u, face vector mu, scalar rho, double dt,
   
   restriction ({mu,rho});
   struct Viscosity p = { mu, rho, dt };
+
+#if CACHE_DIAGONAL
+  vector idiag[];
+  viscosity_diagonal (&p, idiag);
+#endif
   return mg_solve ((scalar *){u}, (scalar *){r},
-		   residual_viscosity, relax_viscosity, &p, nrelax, res);
+		   residual_viscosity, relax_viscosity, &p, nrelax, res,
+		   krylov = krylov, schedule = schedule);
 }
 
 /**
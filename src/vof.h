@@ -317,6 +317,671 @@ static void sweep_x (scalar c, scalar cc, scalar * tcl)
   delete (tfluxl); free (tfluxl);
 }
 
+/**
+## Narrow-band advection
+
+Far from the interface, full (resp. empty) cells surrounded by full
+(resp. empty) cells are not modified by the one-dimensional advection
+scheme above (the flux and compression terms cancel out exactly), so
+that most of the work done by *sweep_x()* is wasted when the interface
+occupies a small fraction of the domain. On trees and multigrids
+(without MPI, periodic boundaries, masks, embedded boundaries or VOF
+tracers), setting *VOF_NARROW_BAND* to `true` restricts the advection
+to a narrow band of cells around the interface.
+
+The band is the list of *interfacial* cells i.e. the cells which are
+not full or empty, which have a neighbour with a different volume
+fraction or which have been modified, during the current timestep, so
+that their step function *cc* is not consistent with their volume
+fraction anymore. The band is one cell wide: since the CFL number is
+smaller than 0.5, the one-dimensional scheme only modifies the
+interfacial cells and the cells which share a face with them along
+the direction of advection.
+
+Volume fractions are compared with a tolerance *VOF_BAND_TOLERANCE*:
+the standard scheme spreads round-off errors (i.e. volume fractions of
+order $10^{-16}$) away from the interface, which would otherwise
+widen the band indefinitely. The results are thus identical to those
+of the standard scheme only up to this tolerance.
+
+The band is built at the first timestep and is then updated after each
+sweep using only the modified cells. After mesh adaptation, it is
+updated using only the leaves which cover the previous band and their
+neighbours along each direction. If the volume fraction is modified
+outside of *vof_advection()* (for example by
+[remove_droplets()](/src/tag.h), which does it), *vof_band_reset()*
+must be called so that the band is rebuilt.
+
+The interfacial cells whose neighbours, within two cells, are leaves
+of the same level are advected in parallel. On adaptive meshes, the
+other interfacial cells are advected one at a time, using the same
+fluxes as the standard scheme through the faces between cells of
+different levels. The restricted values and the values of the ghost
+cells of the volume fraction are then only updated close to the
+modified cells. */
+
+#if (TREE || MULTIGRID) && !_MPI && !_GPU && !EMBED
+# define VOF_BAND 1
+
+bool VOF_NARROW_BAND = false;
+double VOF_BAND_TOLERANCE = 1e-12;
+
+typedef struct {
+  int i;           // the index of the volume fraction field
+  Cache band;      // the interfacial cells with a uniform neighborhood
+  Cache mixed;     // the other interfacial cells
+  long revision;   // the revision of the grid (-1 if the band is invalid)
+  double stamp;    // the stamp of the interfacial cells
+  int levels;      // the levels of the interfacial cells (bit mask)
+} VofBand;
+
+static VofBand * vof_bands = NULL;
+static int vof_nbands = 0;
+
+#if TREE
+# define vof_band_revision() (tree->revision)
+#else
+# define vof_band_revision() 0L
+#endif
+
+/**
+The interfacial cells are marked with a stamp which is unique to each
+band. The step functions of the modified cells are stored, together
+with a stamp unique to each call of *vof_advection()*, in *vof_step*
+i.e. *cc* is `vof_step[] - 2.*vof_call` if this is zero or one. The
+cells visited by a given traversal (for example the cells updated by
+a sweep) are marked, in *vof_seen*, with a stamp unique to this
+traversal. The normals and intercepts of the band are stored in
+*vof_n* and *vof_alpha*, which are allocated once rather than at each
+sweep. */
+
+static scalar vof_mark = {-1}, vof_step = {-1}, vof_cnew = {-1},
+  vof_seen = {-1}, vof_alpha = {-1};
+static vector vof_n;
+static double vof_stamp = 0., vof_call = 0., vof_visit = 0.;
+
+static void vof_bands_free()
+{
+  for (int j = 0; j < vof_nbands; j++) {
+    free (vof_bands[j].band.p);
+    free (vof_bands[j].mixed.p);
+  }
+  free (vof_bands);
+  vof_bands = NULL, vof_nbands = 0;
+  vof_mark.i = vof_step.i = vof_cnew.i = vof_seen.i = vof_alpha.i = -1;
+}
+
+static VofBand * vof_band (scalar c)
+{
+  for (int j = 0; j < vof_nbands; j++)
+    if (vof_bands[j].i == c.i)
+      return &vof_bands[j];
+  if (!vof_bands)
+    free_solver_func_add (vof_bands_free);
+  if (vof_mark.i < 0) {
+    vof_mark = new scalar;
+    vof_step = new scalar;
+    vof_cnew = new scalar;
+    vof_seen = new scalar;
+    vof_alpha = new scalar;
+    vof_n = new vector;
+    for (scalar s in {vof_mark, vof_step, vof_cnew, vof_seen,
+	  vof_alpha, vof_n}) {
+      s.restriction = no_restriction;
+#if TREE
+      s.refine = s.prolongation = no_restriction;
+#endif
+      s.nodump = true;
+    }
+  }
+  qrealloc (vof_bands, vof_nbands + 1, VofBand);
+  VofBand * b = &vof_bands[vof_nbands++];
+  b->i = c.i;
+  b->band = b->mixed = (Cache){0};
+  b->revision = -1;
+  return b;
+}
+
+void vof_band_reset (scalar c)
+{
+  for (int j = 0; j < vof_nbands; j++)
+    if (vof_bands[j].i == c.i)
+      vof_bands[j].revision = -1;
+}
+
+/**
+The bands are rebuilt at the start of each simulation. */
+
+event defaults (i = 0)
+{
+  for (int j = 0; j < vof_nbands; j++)
+    vof_bands[j].revision = -1;
+}
+
+static double vof_band_step (Point point)
+{
+  double cc = vof_step[] - 2.*vof_call;
+  return cc == 0. || cc == 1. ? cc : -1.;
+}
+
+static bool vof_band_interfacial (Point point, scalar c)
+{
+  double tol = VOF_BAND_TOLERANCE;
+  if (c[] > tol && c[] < 1. - tol)
+    return true;
+  foreach_dimension()
+    if (fabs (c[-1] - c[]) > tol || fabs (c[1] - c[]) > tol)
+      return true;
+  double cc = vof_band_step (point);
+  return cc >= 0. && fabs (cc - c[]) > tol;
+}
+
+/**
+The stencil of the one-dimensional scheme (including the
+reconstruction) is the 3x3 neighborhood of the updated cells, which
+are within one cell of the interfacial cells along each direction. */
+
+static bool vof_band_uniform (Point point)
+{
+#if TREE
+  foreach_neighbor (1)
+    if (!is_leaf(cell) && !is_boundary(cell))
+      return false;
+  foreach_dimension()
+    for (int i = -1; i <= 1; i += 2)
+      if (!is_boundary(neighbor(i)) &&
+	  !is_leaf(neighbor(2*i)) && !is_boundary(neighbor(2*i)))
+	return false;
+#endif
+  return true;
+}
+
+static void vof_band_boundary (VofBand * b, scalar * list)
+{
+  for (int l = 0; l <= depth(); l++)
+    if (b->levels & (1 << l))
+      boundary_iterate (level, list, l);
+}
+
+/**
+The ghost children of the cells which do not have a uniform
+neighborhood are also used by the scheme. */
+
+static void vof_band_add (Point point, VofBand * b, bool uniform)
+{
+  if (uniform)
+    cache_append (&b->band, point, 0);
+  else {
+    cache_append (&b->mixed, point, 0);
+    b->levels |= 1 << (level + 1);
+  }
+  b->levels |= 1 << level;
+}
+
+static void vof_band_mark (VofBand * b)
+{
+  scalar mark = vof_mark;
+  b->stamp = ++vof_stamp;
+  foreach_cache (b->band)
+    mark[] = b->stamp;
+  foreach_cache (b->mixed)
+    mark[] = b->stamp;
+}
+
+/**
+On trees, the band is built by traversing the tree and by skipping the
+coarse cells which are full or empty, as well as their neighbours
+(the volume fraction must thus have been restricted). */
+
+#if TREE
+static bool vof_band_bulk (Point point, scalar c)
+{
+  double tol = VOF_BAND_TOLERANCE, c0 = c[];
+  if (c0 > tol && c0 < 1. - tol)
+    return false;
+  foreach_neighbor (1)
+    if (fabs (c[] - c0) > tol)
+      return false;
+  return true;
+}
+#endif
+
+static void vof_band_init (scalar c, VofBand * b)
+{
+  b->band.n = b->mixed.n = 0;
+  b->levels = 0;
+#if TREE
+  foreach_cell() {
+    if (is_boundary(cell) || !is_active(cell))
+      continue;
+    if (is_leaf(cell)) {
+      if (vof_band_interfacial (point, c))
+	vof_band_add (point, b, vof_band_uniform (point));
+      continue;
+    }
+    if (vof_band_bulk (point, c))
+      continue;
+  }
+#else
+  foreach (serial)
+    if (vof_band_interfacial (point, c))
+      vof_band_add (point, b, true);
+#endif
+  vof_band_mark (b);
+}
+
+#if TREE
+/**
+After mesh adaptation, the interfacial cells are among the leaves
+which cover the cells of the previous band, or which are neighbours
+of these leaves. The function below appends the leaves which cover
+the cell at *point* (which may not exist anymore) to *cover*, unless
+they are marked with *stamp*. */
+
+static Point vof_band_parent (Point point)
+{
+  return parent;
+}
+
+static void vof_band_cover (Point point, double stamp, Cache * cover)
+{
+  scalar seen = vof_seen;
+  if (point.level <= depth() && allocated(0) && is_leaf(cell)) {
+    if (seen[] != stamp) {
+      seen[] = stamp;
+      cache_append (cover, point, 0);
+    }
+    return;
+  }
+  while (point.level > depth() || !allocated(0) || is_prolongation(cell))
+    point = vof_band_parent (point);
+  if (is_boundary(cell))
+    return;
+  Point root = point;
+  foreach_cell_root (root)
+    if (is_leaf(cell)) {
+      if (seen[] != stamp) {
+	seen[] = stamp;
+	cache_append (cover, point, 0);
+      }
+      continue;
+    }
+}
+
+static void vof_band_neighbors (Point point, double stamp, Cache * near)
+{
+  vof_band_cover (point, stamp, near);
+  foreach_dimension()
+    for (int i = -1; i <= 1; i += 2)
+      if (!is_boundary(neighbor(i)))
+	vof_band_cover (neighborp(i), stamp, near);
+}
+
+static void vof_band_remap (scalar c, VofBand * b)
+{
+  Cache cover = {0}, near = {0};
+  double stamp = ++vof_visit;
+  Cache * bands[2] = {&b->band, &b->mixed};
+  for (int j = 0; j < 2; j++)
+    for (int k = 0; k < bands[j]->n; k++)
+      vof_band_cover (index_point (cache_index (bands[j], k)), stamp, &cover);
+  stamp = ++vof_visit;
+  for (int k = 0; k < cover.n; k++)
+    vof_band_neighbors (index_point (cache_index (&cover, k)), stamp, &near);
+  free (cover.p);
+  b->band.n = b->mixed.n = 0;
+  b->levels = 0;
+  foreach_cache (near)
+    if (vof_band_interfacial (point, c)) {
+      bool uniform = vof_band_uniform (point);
+      OMP(omp critical)
+	vof_band_add (point, b, uniform);
+    }
+  free (near.p);
+  vof_band_mark (b);
+}
+
+/**
+The ghost values of the volume fraction (see
+[fraction_refine()](fractions.h)) are used by the scheme close to
+cells of different levels. After each sweep, the ancestors of the
+modified leaves are restricted and the leaves of the prolongation halo
+are prolongated, as done by *boundary()*, but only if a cell within
+one cell (or two cells close to the sides of the domain, for boundary
+conditions) has been modified. */
+
+static bool vof_band_changed (Point point, double stamp)
+{
+  foreach_neighbor (is_near_boundary (point) ? 2 : 1)
+    if (vof_seen[] == stamp)
+      return true;
+  return false;
+}
+
+static void vof_band_refresh (scalar c, Cache * updated)
+{
+  scalar seen = vof_seen;
+  Cache * ancestors = qcalloc (depth() + 1, Cache);
+  double stamp = ++vof_visit;
+  for (int k = 0; k < updated->n; k++) {
+    Point point = index_point (cache_index (updated, k));
+    seen[] = stamp;
+    while (point.level > 0) {
+      point = vof_band_parent (point);
+      if (seen[] == stamp)
+	break;
+      seen[] = stamp;
+      cache_append (&ancestors[point.level], point, 0);
+    }
+  }
+  for (int l = depth() - 1; l >= 0; l--) {
+    foreach_cache (ancestors[l])
+      c.restriction (point, c);
+    free (ancestors[l].p);
+  }
+  free (ancestors);
+  boundary_iterate (level, {c}, 0);
+  for (int l = 0; l < depth(); l++) {
+    foreach_halo (prolongation, l)
+      if (vof_band_changed (point, stamp)) {
+	c.prolongation (point, c);
+	foreach_child()
+	  seen[] = stamp;
+      }
+    boundary_iterate (level, {c}, l + 1);
+  }
+}
+#endif // TREE
+
+/**
+Each cell within one cell of the uniform part of the band is updated
+(only once) by the first interfacial cell (along the direction of
+advection) of its neighborhood. */
+
+foreach_dimension()
+static bool vof_band_owner_x (Point point, double stamp, int o)
+{
+  if (is_boundary(neighbor(o)))
+    return false;
+  for (int j = o - 1; j < 0; j++)
+    if (!is_boundary(neighbor(j)) && vof_mark[j] == stamp)
+      return false;
+  return true;
+}
+
+/**
+The flux through the left face of a cell is computed as in
+*sweep_x()*. The interface is not reconstructed in the cells which are
+not in the band (and are full or empty, up to the tolerance). */
+
+foreach_dimension()
+static double vof_band_flux_x (Point point, scalar c, vector n, scalar alpha,
+			       double stamp, double * cfl)
+{
+  double un = uf.x[]*dt/(Delta*fm.x[] + SEPS), s = sign(un);
+  int i = -(s + 1.)/2.;
+  if (un*fm.x[]*s/(cm[] + SEPS) > *cfl)
+    *cfl = un*fm.x[]*s/(cm[] + SEPS);
+  double cf = (c[i] <= 0. || c[i] >= 1. ||
+	       (!is_boundary(neighbor(i)) && vof_mark[i] != stamp)) ? c[i] :
+    rectangle_fraction ((coord){-s*n.x[i], n.y[i], n.z[i]}, alpha[i],
+			(coord){-0.5, -0.5, -0.5},
+			(coord){s*un - 0.5, 0.5, 0.5});
+  return cf*uf.x[];
+}
+
+/**
+On trees, the flux through a face between cells of different levels
+is the average of the fluxes through the faces of the fine cells, as
+for the standard scheme (see *halo_face()* in
+[tree-common.h](/src/grid/tree-common.h)). */
+
+foreach_dimension()
+static double vof_band_face_x (Point point, scalar c, vector n, scalar alpha,
+			       double stamp, double * cfl)
+{
+#if TREE
+  if (is_refined(cell) || is_refined(neighbor(-1))) {
+    double f = 0.;
+    foreach_child()
+      if (child.x < 0)
+	f += vof_band_flux_x (point, c, n, alpha, stamp, cfl);
+    return f/(1 << (dimension - 1));
+  }
+#endif // TREE
+  return vof_band_flux_x (point, c, n, alpha, stamp, cfl);
+}
+
+foreach_dimension()
+static void vof_band_update_x (Point point, scalar c, vector n, scalar alpha,
+			       double stamp, double * cfl)
+{
+  scalar step = vof_step, cnew = vof_cnew, seen = vof_seen;
+  double cc = vof_band_step (point);
+  if (cc < 0.)
+    cc = (c[] > 0.5), step[] = 2.*vof_call + cc;
+  cnew[] = c[] + dt*(vof_band_face_x (point, c, n, alpha, stamp, cfl) -
+		     vof_band_face_x (neighborp(1), c, n, alpha, stamp, cfl) +
+		     cc*(uf.x[1] - uf.x[]))/(cm[]*Delta);
+  seen[] = vof_visit;
+}
+
+#if TREE
+/**
+The cells of the band which do not have a uniform neighborhood are
+advected one at a time: the leaves which share a face with them
+(along the direction of advection) are updated, unless they have
+already been updated during this sweep, and are appended to
+*updated*. */
+
+foreach_dimension()
+static void vof_band_leaf_x (Point point, scalar c, vector n, scalar alpha,
+			     double stamp, double * cfl, Cache * updated)
+{
+  if (vof_seen[] != vof_visit) {
+    vof_band_update_x (point, c, n, alpha, stamp, cfl);
+    cache_append (updated, point, 0);
+  }
+}
+
+foreach_dimension()
+static void vof_band_children_x (Point point, int side,
+				 scalar c, vector n, scalar alpha,
+				 double stamp, double * cfl, Cache * updated)
+{
+  foreach_child()
+    if (child.x == side)
+      vof_band_leaf_x (point, c, n, alpha, stamp, cfl, updated);
+}
+
+foreach_dimension()
+static void vof_band_mixed_x (Point point, scalar c, vector n, scalar alpha,
+			      double stamp, double * cfl, Cache * updated)
+{
+  vof_band_leaf_x (point, c, n, alpha, stamp, cfl, updated);
+  for (int o = -1; o <= 1; o += 2)
+    if (is_boundary(neighbor(o)))
+      continue;
+    else if (is_leaf(neighbor(o)))
+      vof_band_leaf_x (neighborp(o), c, n, alpha, stamp, cfl, updated);
+    else if (is_prolongation(neighbor(o)))
+      vof_band_leaf_x (vof_band_parent (neighborp(o)),
+		       c, n, alpha, stamp, cfl, updated);
+    else if (is_refined(neighbor(o)))
+      vof_band_children_x (neighborp(o), - o,
+			   c, n, alpha, stamp, cfl, updated);
+}
+
+/**
+The normal and intercept of the cells which do not have a uniform
+neighborhood are prolongated onto their ghost children, which are
+also marked, as done by the standard scheme (see
+[reconstruction()](fractions.h#interface-reconstruction)). */
+
+static void vof_band_prolongation (Point point, vector n, scalar alpha,
+				   double stamp)
+{
+  if (cell.neighbors > 0) {
+    foreach_dimension()
+      refine_injection (point, n.x);
+    alpha_refine (point, alpha);
+    foreach_child()
+      vof_mark[] = stamp;
+  }
+}
+#endif // TREE
+
+/**
+The intercepts of the band are computed at once using
+[plane_alpha_batch()](geometry.h#batched-functions). The normals and
+volume fractions of the *k*-th cell of the band are gathered in the
+*k*-th entries of the arrays. */
+
+static void vof_band_gather (Point point, scalar c, vector n,
+			     double * cb, coord_array mb, int k)
+{
+  if (c[] <= 0. || c[] >= 1.) {
+    foreach_dimension()
+      n.x[] = 0., mb.x[k] = 1.; // the intercept is not used
+  }
+  else {
+    coord m = interface_normal (point, c);
+    foreach_dimension()
+      n.x[] = mb.x[k] = m.x;
+  }
+  cb[k] = c[];
+}
+
+static Point vof_band_point (VofBand * b, int k)
+{
+  return k < b->band.n ? index_point (cache_index (&b->band, k)) :
+    index_point (cache_index (&b->mixed, k - b->band.n));
+}
+
+static void vof_band_reconstruction (scalar c, VofBand * b,
+				     vector n, scalar alpha)
+{
+  int nb = b->band.n + b->mixed.n;
+  double * cb = qmalloc (nb*(dimension + 2), double);
+  coord_array mb;
+  int d = 1;
+  foreach_dimension()
+    mb.x = cb + (d++)*nb;
+  double * ab = cb + (dimension + 1)*nb;
+  OMP (omp parallel for schedule(static))
+  for (int k = 0; k < nb; k++)
+    vof_band_gather (vof_band_point (b, k), c, n, cb, mb, k);
+  plane_alpha_batch (nb, cb, mb, ab);
+  OMP (omp parallel for schedule(static))
+  for (int k = 0; k < nb; k++) {
+    Point point = vof_band_point (b, k);
+    alpha[] = c[] <= 0. || c[] >= 1. ? 0. : ab[k];
+  }
+  free (cb);
+#if TREE
+  alpha.n = n;
+  for (int k = 0; k < b->mixed.n; k++)
+    vof_band_prolongation (index_point (cache_index (&b->mixed, k)),
+			   n, alpha, b->stamp);
+#endif
+  vof_band_boundary (b, (scalar *){n, alpha});
+}
+
+/**
+The one-dimensional advection of the band. */
+
+foreach_dimension()
+static void vof_band_sweep_x (scalar c, VofBand * b)
+{
+  vector n = vof_n;
+  scalar alpha = vof_alpha, cnew = vof_cnew;
+  double cfl = 0.;
+  vof_visit++;
+  vof_band_reconstruction (c, b, n, alpha);
+  foreach_cache (b->band, reduction(max:cfl))
+    for (int o = -1; o <= 1; o++)
+      if (vof_band_owner_x (point, b->stamp, o))
+	vof_band_update_x (neighborp(o), c, n, alpha, b->stamp, &cfl);
+  Cache updated = {0};
+  for (int k = 0; k < b->band.n; k++) {
+    Point point = index_point (cache_index (&b->band, k));
+    for (int o = -1; o <= 1; o++)
+      if (vof_band_owner_x (point, b->stamp, o))
+	cache_append (&updated, neighborp(o), 0);
+  }
+#if TREE
+  for (int k = 0; k < b->mixed.n; k++)
+    vof_band_mixed_x (index_point (cache_index (&b->mixed, k)),
+		      c, n, alpha, b->stamp, &cfl, &updated);
+#endif
+  if (cfl > 0.5 + 1e-6)
+    fprintf (ferr, 
+	     "src/vof.h:%d: warning: CFL must be <= 0.5 for VOF (cfl - 0.5 = %g)\n", 
+	     LINENO, cfl - 0.5), fflush (ferr);
+  foreach_cache (updated)
+    c[] = cnew[];
+#if TREE
+  if (!tree_is_full())
+    vof_band_refresh (c, &updated);
+  else
+#endif
+    vof_band_boundary (b, {c});
+
+  /**
+  The new band is made of the interfacial cells among the updated
+  cells. */
+
+  b->band.n = b->mixed.n = 0;
+  b->levels = 0;
+  foreach_cache (updated)
+    if (vof_band_interfacial (point, c)) {
+      bool uniform = vof_band_uniform (point);
+      OMP(omp critical)
+	vof_band_add (point, b, uniform);
+    }
+  free (updated.p);
+  vof_band_mark (b);
+}
+
+/**
+The function below advects *c* and returns `true`, or returns `false`
+if the narrow-band advection cannot be used. */
+
+static bool vof_band_advection (scalar c, int i)
+{
+  foreach_dimension()
+    if (Period.x)
+      return false;
+#if TREE
+  update_cache();
+  if (tree->masked)
+    return false;
+#endif
+  VofBand * b = vof_band (c);
+  vof_call++;
+  if (b->revision < 0) {
+    restriction ({c});
+    vof_band_init (c, b);
+  }
+#if TREE
+  else if (b->revision != vof_band_revision())
+    vof_band_remap (c, b);
+#endif
+  else
+    vof_band_boundary (b, {c});
+  b->revision = vof_band_revision();
+
+  void (* sweep[dimension]) (scalar, VofBand *);
+  int d = 0;
+  foreach_dimension()
+    sweep[d++] = vof_band_sweep_x;
+  for (d = 0; d < dimension; d++)
+    sweep[(i + d) % dimension] (c, b);
+  c.dirty = true;
+  return true;
+}
+#endif // (TREE || MULTIGRID) && !_MPI && !_GPU && !EMBED
+
 /**
 ## Multi-dimensional advection
 
@@ -325,6 +990,10 @@ The multi-dimensional advection is performed by the event below. */
 void vof_advection (scalar * interfaces, int i)
 {
   for (scalar c in interfaces) {
+#if VOF_BAND
+    if (VOF_NARROW_BAND && !c.tracers && vof_band_advection (c, i))
+      continue;
+#endif
 
     /**
     We first define the volume fraction field used to compute the